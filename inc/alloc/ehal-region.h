@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_REGION__H
+#define __EHAL_REGION__H
+
+#include <stdint.h>
+#include "state/ehal-state.h"
+
+//
+// Reservations of exact eMem offsets, as legacy e_alloc() callers and their
+// eCore kernels expect data at fixed addresses.
+// Reservations never overlap each other nor the general heap (mspace, slab).
+// The top of the eMem is set aside for them at bootstrap, the region area:
+// EREGION_AREA bytes, i.e. the eSDK's shared DRAM from offset 0x01000000 on,
+// at most half of the mapped eMem, resized by EHAL_EMEM_REGIONS (bytes, 0
+// for none). Reservations within it coexist with any heap usage.
+// A reservation within the heap's span instead is solely possible while the
+// heap holds no live allocation: the heap then gets rebuilt over the largest
+// gap left between the reservations below the region area. Releasing such a
+// reservation lets the heap grow again at the next such opportunity.
+// Any access of the central heap (slab, mspace, statistics) holds
+// eRegionHeapLock() shared, a rebuild holds it exclusively. The thread
+// caches' bins go without: cached blocks are live to the slab, hence
+// rule out a rebuild themselves.
+// Should a rebuild fail and the heap not come back at its old span either,
+// the heap is lost (space NULL): allocations fail and the reservation
+// resp. release reports -1 resp. NULL.
+//
+#define EREGION_MAX         32
+#define EREGION_MIN_HEAP    0x20000     // 2 slabs
+#define EREGION_AREA        0x01000000  // default region area
+
+// bytes of the region area at the top of an arena of arenaSize bytes
+uint32_t eRegionAreaSize(uint32_t arenaSize);
+// the heap spans the arena's first heapSize bytes, the region area the rest
+int eRegionInit(eConfigMem_t *emem, char *arenaBase, uint32_t arenaSize, uint32_t heapSize);
+void eRegionFini(eConfigMem_t *emem);
+
+// offset relative to epi_base, returns the host address or NULL
+void* eRegionReserve(eConfigMem_t *emem, uint32_t offset, uint32_t size);
+int eRegionRelease(eConfigMem_t *emem, uint32_t offset);
+
+// shared against a rebuild, no-ops ahead of eRegionInit() resp. after eRegionFini()
+void eRegionHeapLock(eConfigMem_t *emem);
+void eRegionHeapUnlock(eConfigMem_t *emem);
+
+// heap span and reserved bytes, see alloc/ehal-stats.h
+struct eMemStats_s;
+void eRegionStats(eConfigMem_t *emem, struct eMemStats_s *stats);
+
+#endif /* __EHAL_REGION__H */
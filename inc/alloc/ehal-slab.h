@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_SLAB__H
+#define __EHAL_SLAB__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "state/ehal-state.h"
+
+//
+// Size-class slab allocator on top of the eMem mspace.
+// Slabs of ESLAB_SIZE bytes are carved from the mspace aligned to their own
+// size, hence the slab of any pointer is found by (ptr - epi_base) >> 16.
+// All bookkeeping (free stacks) is kept in host memory, eMem itself is never
+// touched by alloc/free. Sizes above the largest class go to the mspace.
+//
+//   class        8,   16,   32                    aligned to    8
+//   class       64 .. 2048                        aligned to   64 (DMA)
+//   class     4096 .. 65536                       aligned to 4096 (page)
+//
+#define ESLAB_SHIFT         16
+#define ESLAB_SIZE          (1u << ESLAB_SHIFT)
+#define ESLAB_CLASSES       14
+#define ESLAB_MAX           ESLAB_SIZE
+#define ESLAB_LARGE_ALIGN   4096
+
+typedef struct {
+  void *host;                       // host virtual address
+  uint32_t eaddr;                   // same buffer as seen by the eCores
+} eMemPtr_t;
+
+// power of two classes: 8 -> 0, 16 -> 1, ..., 65536 -> 13
+inline static unsigned eSlabClass(size_t size)
+{
+  if(size <= 8)
+    return 0;
+  return (sizeof(unsigned long long) * 8 - __builtin_clzll(size - 1)) - 3;
+}
+
+inline static size_t eSlabClassSize(unsigned cls)
+{
+  return (size_t)8 << cls;
+}
+
+int eSlabInit(eConfigMem_t *emem);
+void eSlabFini(eConfigMem_t *emem);
+
+eMemPtr_t eSlabAlloc(eConfigMem_t *emem, size_t size);
+void eSlabFree(eConfigMem_t *emem, void *host);
+
+// central transfer of up to n blocks of one class under a single lock,
+// used by the per-thread caches (alloc/ehal-tcache.h)
+unsigned eSlabAllocBatch(eConfigMem_t *emem, unsigned cls, void **blocks, unsigned n);
+void eSlabFreeBatch(eConfigMem_t *emem, void **blocks, unsigned n);
+
+// release cached empty slabs, returns the number of slabs still in use
+unsigned eSlabTrim(eConfigMem_t *emem);
+
+// statistics, see alloc/ehal-stats.h
+struct eMemStats_s;
+void eSlabCount(eConfigMem_t *emem, uint64_t allocs, uint64_t frees);
+void eSlabStats(eConfigMem_t *emem, struct eMemStats_s *stats);
+
+// usable size of an allocation, 0 if not owned by the slab
+size_t eSlabUsableSize(eConfigMem_t *emem, const void *host);
+
+#define eMemHostToEpi( emem, p )  ((uint32_t)(uintptr_t)(emem)->epi_base + (uint32_t)((char*)(p) - (emem)->epi_base))
+#define eMemEpiToHost( emem, e )  ((void*)((emem)->epi_base + ((uint32_t)(e) - (uint32_t)(uintptr_t)(emem)->epi_base)))
+
+#endif /* __EHAL_SLAB__H */
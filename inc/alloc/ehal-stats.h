@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_STATS__H
+#define __EHAL_STATS__H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "state/ehal-state.h"
+
+typedef struct eMemStats_s {
+  size_t heapSize;                  // span of the general heap (mspace)
+  size_t regionBytes;               // region area, see alloc/ehal-region.h
+  size_t reservedBytes;             // exact offsets, see eMemReserve()
+  size_t liveBytes;                 // handed out, rounded to size class
+  size_t cachedBytes;               // free blocks within the thread caches, not within liveBytes
+  size_t peakBytes;                 // high-water mark of liveBytes + cachedBytes
+  size_t slabBytes;                 // eMem held by slabs
+  size_t slabFreeBytes;             // free blocks within slabs
+  size_t mspaceUsed;                // mspace chunks in use (slabs, large buffers, overhead)
+  size_t mspaceFree;                // mspace chunks free
+  size_t largestFree;               // largest contiguous free chunk of the mspace
+  double fragmentation;             // 1 - largestFree / mspaceFree, 0 is none
+  uint64_t allocs;                  // eMemAlloc() calls, see eStatsGet()
+  uint64_t frees;
+  unsigned slabs;
+} eMemStats_t;
+
+// optional allocation trace, a ring of the most recent operations
+typedef struct {
+  uint64_t ns;                      // CLOCK_MONOTONIC
+  uint32_t eaddr;
+  int32_t size;                     // < 0 for free
+} eMemTrace_t;
+
+extern eMemTrace_t *etrace;
+
+// allocs/frees include all of the calling thread's calls, those of other
+// threads lag by up to ETCACHE_SCAVENGE calls each until they exit
+int eStatsGet(eConfigMem_t *emem, eMemStats_t *stats);
+void eStatsPrint(FILE *out, const eMemStats_t *stats);
+
+// the ring keeps the entries of its first start until eStatsTraceFini(),
+// recorders might still be in flight on it
+int eStatsTraceStart(unsigned entries);
+void eStatsTraceStop(void);
+size_t eStatsTraceRead(eMemTrace_t *out, size_t n);
+void eStatsTraceFini(void);
+void eStatsTraceRecord(uint32_t eaddr, int32_t size);
+
+#define eStatsTrace( eaddr, size ) \
+({ \
+  if(__builtin_expect(etrace != NULL, 0)) \
+    eStatsTraceRecord((eaddr), (size)); \
+})
+
+#endif /* __EHAL_STATS__H */
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_TCACHE__H
+#define __EHAL_TCACHE__H
+
+#include <stddef.h>
+#include "alloc/ehal-slab.h"
+
+//
+// Per-thread caches in front of the slab allocator. Each thread keeps a
+// bin of free blocks per size class, hence alloc/free usually take no lock.
+// Bins are refilled from and returned to the central slab in batches,
+// i.e. one lock per batch:
+//   - a full bin returns its older half
+//   - every ETCACHE_SCAVENGE operations, bins are trimmed to half of their
+//     capacity, so idle memory flows back to other threads
+//   - on thread exit, all bins are returned
+// Each bin holds up to ETCACHE_BIN_BYTES, but at most ETCACHE_DEPTH blocks.
+//
+#define ETCACHE_DEPTH       64
+#define ETCACHE_BIN_BYTES   0x10000
+#define ETCACHE_SCAVENGE    4096
+
+eMemPtr_t eTcacheAlloc(eConfigMem_t *emem, size_t size);
+void eTcacheFree(eConfigMem_t *emem, void *host);
+
+// return all blocks cached by the calling thread
+void eTcacheFlush(void);
+
+// report the calling thread's alloc/free counts for emem to the slab now,
+// other threads report theirs every ETCACHE_SCAVENGE operations resp. on exit
+void eTcacheCount(eConfigMem_t *emem);
+
+// bytes cached by all threads for emem, a snapshot as the threads go on
+size_t eTcacheCached(eConfigMem_t *emem);
+
+#endif /* __EHAL_TCACHE__H */
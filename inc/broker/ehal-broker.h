@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_BROKER__H
+#define __EHAL_BROKER__H
+
+#include <stdint.h>
+#include "state/ehal-state.h"
+
+//
+// The broker (ehal-brokerd) keeps the EPIPHANY bootstrapped and hands out
+// leases to short living clients over a Unix socket. A lease consists of a
+// rectangle of eCores and a range within eMem. Together with the lease, the
+// client receives the already opened device fd (SCM_RIGHTS) and solely maps
+// the leased eCores and eMem range of it, no FPGA regs. The broker never hands
+// out /dev/mem (all of the physical memory), it requires the epiphany driver.
+// The fd itself does not confine the client to the lease, that is left to the
+// driver. The lease is held as long as the client keeps the connection open.
+//
+// Client side is selected by the environment:
+//   EHAL_BROKER        path of the broker socket
+//   EHAL_LEASE_CORES   "row,col,rows,cols" relative to the chip (default: whole chip)
+//   EHAL_LEASE_EMEM    bytes of eMem to lease (default: EBROKER_DEFAULT_EMEM)
+//
+#define EBROKER_DEFAULT_PATH    "/run/ehal-broker.sock"
+#define EBROKER_DEFAULT_EMEM    0x400000
+#define EBROKER_MAX_CLIENTS     64
+
+typedef struct {
+  uint32_t row;                     // relative to eCoreRoot
+  uint32_t col;
+  uint32_t rows;                    // 0 -> whole chip
+  uint32_t cols;
+  uint32_t ememOffset;              // relative to emem[0].epi_base
+  uint32_t ememSize;
+} eBrokerLease_t;
+
+extern eBrokerLease_t ebrokerLease;
+
+// daemon
+int eBrokerServe(eConfig_t *cfg, const char *path);
+void eBrokerStop(void);
+
+// client
+int eBrokerAcquire(const char *path, eBrokerLease_t *lease, eConfigChip_t *chip, int *fd);
+void eBrokerRelease(void);
+
+#endif /* __EHAL_BROKER__H */
@@ -6,6 +6,7 @@
 
 #include <epiphany-hal-data.h>
 #include <epiphany-hal-data-local.h>
+#include "ehal-view.h"
 
 int e_init(char *hdf);
 int e_finalize();
@@ -20,6 +21,53 @@ int e_free(e_mem_t *mbuf);
 
 ssize_t e_write(void *dev, unsigned row, unsigned col,
                 off_t to_addr, const void *buf, size_t size);
+// zero-copy view of size bytes at addr of the SRAM of a core in a group resp.
+// of a buffer in external memory (dev as for e_write), empty if they exceed
+// it, see ehal-view.h resp. ehal::View of ehal-view.hpp
+eView_t e_view(void *dev, unsigned row, unsigned col, off_t addr, size_t size);
+
+// scattered writes to the SRAM of cores in a group, merged into ascending
+// bursts per core, later items win on overlaps
+typedef struct {
+	unsigned    row, col;
+	off_t       offset;
+	const void *buf;
+	size_t      size;
+} e_iovec_t;
+ssize_t e_writev(e_epiphany_t *dev, const e_iovec_t *iov, unsigned n);
+
+// row-major matrix of rows * tile_rows x cols * tile_cols elements into
+// resp. out of the SRAM of the group, core (r,c) holds tile (r,c) packed at
+// the same address, stride 0 if the matrix rows are packed
+ssize_t e_tile_scatter(e_epiphany_t *dev, off_t to_addr, const void *matrix,
+                       unsigned tile_rows, unsigned tile_cols,
+                       size_t elem_size, size_t stride);
+ssize_t e_tile_gather(e_epiphany_t *dev, off_t from_addr, void *matrix,
+                      unsigned tile_rows, unsigned tile_cols,
+                      size_t elem_size, size_t stride);
+
+// larger reads of core SRAM get bounced through eMem by the core's DMA
+ssize_t e_read(void *dev, unsigned row, unsigned col,
+               off_t from_addr, void *buf, size_t size);
+
+// file contents directly into / out of an e_alloc()'ed buffer,
+// size 0 on load fills the buffer resp. stops at the end of the file,
+// E_ERR beyond the buffer
+ssize_t e_load_data(e_mem_t *mbuf, off_t to_addr,
+                    const char *fname, off_t foff, size_t size);
+ssize_t e_store_data(e_mem_t *mbuf, off_t from_addr,
+                     const char *fname, off_t foff, size_t size);
+
+// e_write / e_read done by worker threads, see ehal-async.h. The handle
+// gets released by e_async_wait(), its eventfd along with it.
+typedef struct eXfer_s e_async_t;
+e_async_t* e_write_async(void *dev, unsigned row, unsigned col,
+                         off_t to_addr, const void *buf, size_t size);
+e_async_t* e_read_async(void *dev, unsigned row, unsigned col,
+                        off_t from_addr, void *buf, size_t size);
+int e_async_poll(e_async_t *handle);
+int e_async_fd(e_async_t *handle);
+ssize_t e_async_wait(e_async_t *handle);
 
 int e_reset_system(e_epiphany_t *dev);
 
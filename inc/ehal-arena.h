@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_ARENA__H
+#define __EHAL_ARENA__H
+
+//
+// Arena with offset based pointers for data structures shared via eMem.
+// Links are stored as eRel_t, an offset from the arena header, hence the
+// host (arena at its host address) and the eCores (arena at its Epiphany
+// address) resolve them alike with their own pointer to the arena. Graphs,
+// trees or job descriptors get built once and traversed by the eCores as is.
+// Offset 0 is the header itself and serves as NULL.
+//
+// Building (eArenaInit, eArenaAlloc) is meant for the host, resolving and
+// validating works on both sides, the header builds with e-gcc as well.
+//
+
+#include <stdint.h>
+
+#define EARENA_MAGIC        0x41524e45      // "ENRA"
+
+typedef uint32_t eRel_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t size;                    // bytes, including this header
+  uint32_t used;                    // bump offset, everything below is allocated
+  uint32_t epi_base;                // Epiphany address of this header
+} eArena_t;
+
+// offset -> pointer, O(1) with the caller's view of the arena
+#define eArenaAt( arena, rel, T )   ((T*)((char*)(arena) + (rel)))
+// pointer -> offset, p must lie within arena
+#define eArenaRel( arena, p )       ((eRel_t)((char*)(p) - (char*)(arena)))
+// offset -> Epiphany address, e.g. for DMA descriptors built by the host
+#define eArenaToEpi( arena, rel )   ((arena)->epi_base + (rel))
+
+inline static int eArenaValid(const eArena_t *arena, eRel_t rel, uint32_t size)
+{
+  return arena->magic == EARENA_MAGIC
+         && rel >= sizeof(eArena_t)
+         && rel <= arena->used
+         && size <= arena->used - rel;
+}
+
+// validating variant of eArenaAt, NULL if [rel, rel+sizeof(T)) is not allocated
+#define eArenaGet( arena, rel, T ) \
+  (eArenaValid((arena), (rel), sizeof(T)) ? eArenaAt((arena), (rel), T) : (T*)0)
+
+#ifndef __epiphany__
+
+inline static eArena_t* eArenaInit(void *mem, uint32_t size, uint32_t epi_base)
+{
+  eArena_t *arena = (eArena_t*)mem;
+  if(!arena || size < sizeof(*arena))
+    return (eArena_t*)0;
+  arena->magic = EARENA_MAGIC;
+  arena->size = size;
+  arena->used = sizeof(*arena);
+  arena->epi_base = epi_base;
+  return arena;
+}
+
+// align has to be a power of 2, returns 0 if the arena is exhausted
+inline static eRel_t eArenaAlloc(eArena_t *arena, uint32_t size, uint32_t align)
+{
+  uint32_t used = __atomic_load_n(&arena->used, __ATOMIC_RELAXED), rel;
+  do {
+    rel = (used + align - 1) & ~(align - 1);
+    if(rel < used || size > arena->size || rel > arena->size - size)
+      return 0;
+  } while(!__atomic_compare_exchange_n(&arena->used, &used, rel + size, 1,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  return rel;
+}
+
+#define eArenaNew( arena, T ) \
+  eArenaAlloc((arena), sizeof(T), _Alignof(T))
+
+#endif /* __epiphany__ */
+
+#endif /* __EHAL_ARENA__H */
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_ASYNC__H
+#define __EHAL_ASYNC__H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "ehal-writev.h"
+
+//
+// Asynchronous transfers, the host computes while worker threads drive the
+// eLink. Transfers are prepared as handles, submitted (alone or as a batch
+// under a single lock) and completed by the workers in submission order
+// (with a single worker, the default). Completion is observed by
+//   eXferPoll()      non-blocking
+//   eXferWait()      blocking, returns what the transfer returned resp. -1
+//                    if never submitted
+//   eXferFd()        eventfd, readable once done, e.g. for poll()/epoll
+// Every handle gets released with eXferFree() (waits if still pending).
+//
+// The workers start with the first submission, pinned to the CPU given by
+// EHAL_ASYNC_CPU (unpinned if unset) and EHAL_ASYNC_WORKERS of them (1 if
+// unset), or explicitly with eAsyncStart(). eAsyncStop() drains the queue;
+// while it waits for the workers to exit, submissions and eAsyncStart() fail.
+//
+#define EASYNC_BATCH        16              // transfers a worker takes at once
+
+typedef struct eXfer_s eXfer_t;
+
+// cpu < 0 leaves the workers unpinned, 0 if running
+int eAsyncStart(int cpu, unsigned workers);
+void eAsyncStop(void);
+
+// dst resp. src as mapped by the host, i.e. eCore SRAM or eMem
+eXfer_t* eXferWrite(volatile void *dst, const void *src, size_t size);
+eXfer_t* eXferRead(void *dst, const volatile void *src, size_t size);
+// vec is used as is, it has to stay valid until completion
+eXfer_t* eXferWritev(const eWriteVec_t *vec, unsigned n);
+
+int eXferSubmit(eXfer_t **xfers, unsigned n);
+
+int eXferPoll(eXfer_t *xfer);
+ssize_t eXferWait(eXfer_t *xfer);
+int eXferFd(eXfer_t *xfer);
+void eXferFree(eXfer_t *xfer);
+
+#endif /* __EHAL_ASYNC__H */
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_BANKS__H
+#define __EHAL_BANKS__H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "memmap-epiphany-cores.h"
+
+//
+// Bank-aware layout of an eCore's SRAM (eCoreMemMap_t::bank).
+// Each of the four 8KB banks serves one access per cycle, hence instruction
+// fetch, load/store, DMA and accesses over the mesh stall each other as soon
+// as they hit the same bank. The planner places named buffers into banks such
+// that buffers touched by different agents land in different banks, heaviest
+// first, and warns about the contention it could not avoid.
+//
+//   eBankPlanInit()      empty SRAM
+//   eBankPlanReserve()   occupied ranges, e.g. the code (extent_srec()) and stack
+//   eBankPlace()         assigns eBankBuf_t::offset to all buffers
+//   eBankPlanApply()     hands the offsets to the eCores, eBankPlanHeader()
+//                        to the eCore build instead
+//
+#define EBANK_NUM           4
+#define EBANK_SIZE          0x2000
+#define EBANK_WINDOWS       4               // free windows tracked per bank
+
+// agents accessing a buffer resp. bank
+#define EBANK_FETCH         0x1             // instruction fetch
+#define EBANK_LDST          0x2             // load / store of the eCore itself
+#define EBANK_DMA           0x4             // local DMA engine
+#define EBANK_MESH          0x8             // writes from other eCores or the host
+#define EBANK_AGENTS        4
+
+typedef struct {
+  const char *name;
+  uint32_t size;
+  uint32_t align;                   // power of 2, 0 -> 8 (double word)
+  unsigned access;                  // EBANK_* agents
+  unsigned weight;                  // relative access rate, 0 for cold data
+  int bank;                         // -1 for any, otherwise the bank to start in
+  uint32_t offset;                  // out: SRAM offset
+} eBankBuf_t;
+
+// Reservations in the middle of a free window split it. Beyond EBANK_WINDOWS
+// windows a bank keeps the larger side, eBankPlanReserve() warns about the
+// bytes given up.
+typedef struct {
+  uint32_t lo[EBANK_NUM][EBANK_WINDOWS]; // free windows [lo, hi) of each bank,
+  uint32_t hi[EBANK_NUM][EBANK_WINDOWS]; // unsorted, unused if lo == hi
+  unsigned load[EBANK_NUM][EBANK_AGENTS]; // summed weights per agent
+} eBankPlan_t;
+
+void eBankPlanInit(eBankPlan_t *plan);
+int eBankPlanReserve(eBankPlan_t *plan, uint32_t offset, uint32_t size,
+                     unsigned access, unsigned weight);
+
+// returns the number of banks with contending agents, -1 if the buffers do
+// not fit (offsets are undefined then)
+int eBankPlace(eBankPlan_t *plan, eBankBuf_t *bufs, unsigned n);
+
+// writes the n offsets as uint32_t to SRAM offset `table` of all eCores
+int eBankPlanApply(const eBankBuf_t *bufs, unsigned n, uint32_t table,
+                   eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd);
+// #define <prefix><NAME> 0x...
+void eBankPlanHeader(FILE *out, const char *prefix, const eBankBuf_t *bufs, unsigned n);
+
+void eBankPlanPrint(FILE *out, const eBankPlan_t *plan, const eBankBuf_t *bufs, unsigned n);
+
+#endif /* __EHAL_BANKS__H */
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_BULK__H
+#define __EHAL_BULK__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <linux/ioctl.h>
+
+//
+// Bulk transfers between host DRAM and eMem resp. eCore SRAM, through a
+// pluggable backend:
+//   memcpy   the CPU copies (eCopy()/eCopyFrom()), always available, default
+//   pl330    the Zynq's PL330 DMA controller copies via dmaengine, the A9
+//            solely sleeps in the ioctl() until the transfer completed.
+//            Opt-in, it needs the client driver at EBULK_PL330_DEV.
+// Transfers below EBULK_MIN do not amortise a DMA setup and are copied by the
+// CPU with any backend, as are transfers a backend failed on.
+// The backend gets chosen on first use by EHAL_BULK (memcpy, pl330), memcpy
+// if unset resp. if pl330 is not available, or explicitly with eBulkUse().
+//
+#define EBULK_MIN           0x10000         // bytes
+
+typedef enum {
+  EBULK_TO_DEVICE = 0,              // host DRAM -> eMem/SRAM
+  EBULK_FROM_DEVICE                 // eMem/SRAM -> host DRAM
+} eBulkDir_t;
+
+typedef struct {
+  const char *name;
+  int (*open)(void);                // 0 if usable
+  void (*close)(void);
+  // blocking, addresses as mapped by the host, 0 on success
+  int (*copy)(volatile void *dst, const volatile void *src, size_t size, eBulkDir_t dir);
+} eBulkBackend_t;
+
+extern const eBulkBackend_t eBulkMemcpy;
+extern const eBulkBackend_t eBulkPl330;
+
+// closes the current backend, falls back to memcpy (-1) if be does not open,
+// not while transfers are in flight
+int eBulkUse(const eBulkBackend_t *be);
+const eBulkBackend_t* eBulkCurrent(void);
+void eBulkFini(void);
+
+ssize_t eBulkWrite(volatile void *dst, const void *src, size_t size);
+ssize_t eBulkRead(void *dst, const volatile void *src, size_t size);
+
+
+//
+// The pl330 backend talks to a dmaengine client driver at EBULK_PL330_DEV.
+// Per EBULK_PL330_COPY it resolves both user ranges to bus addresses (pinned
+// pages of host DRAM, the PFN mappings of eMem and SRAM), issues DMA_MEMCPY
+// descriptors on a PL330 channel and returns once they completed.
+//
+#define EBULK_PL330_DEV     "/dev/epiphany-dma"
+
+typedef struct {
+  uint64_t dst;                     // user VAs
+  uint64_t src;
+  uint64_t size;
+} eBulkPl330Copy_t;
+
+#define EBULK_PL330_COPY    _IOW('E', 0x40, eBulkPl330Copy_t)
+
+#endif /* __EHAL_BULK__H */
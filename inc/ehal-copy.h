@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_COPY__H
+#define __EHAL_COPY__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//
+// Copy kernels for host writes into eCore SRAM resp. eMem over the eLink.
+// The eLink reaches its peak solely with 64-bit writes at ascending addresses
+// (see the performance hints in ehal.c), whereas memcpy() mixes widths and
+// may run backwards or unaligned. eCopy()/eFill() hence
+//   - store the head byte, half, word wise up to the first 8 byte boundary
+//   - store the body as 64-bit writes (NEON d-registers on ARMv7)
+//   - store the tail word, half, byte wise
+// all at strictly ascending addresses. Small sizes known at compile time
+// with an 8 byte aligned destination unroll into plain 64-bit stores.
+// eCopyFrom() does the same for reads, aligned on the source.
+//
+#define ECOPY_INLINE        64              // bytes, largest unrolled copy
+
+void eCopyBlock(volatile void *dst, const void *src, size_t size);
+void eFillBlock(volatile void *dst, uint8_t c, size_t size);
+void eCopyFrom(void *dst, const volatile void *src, size_t size);
+
+inline static void eCopy(volatile void *dst, const void *src, size_t size)
+{
+  if(__builtin_constant_p(size) && size <= ECOPY_INLINE
+     && !(size & 7) && !((uintptr_t)dst & 7)) {
+    for(size_t i = 0; i < size; i += 8) {
+      uint64_t v;
+      memcpy(&v, (const char*)src + i, sizeof(v));
+      *(volatile uint64_t*)((volatile char*)dst + i) = v;
+    }
+  }
+  else if(__builtin_constant_p(size) && size == 4 && !((uintptr_t)dst & 3)) {
+    uint32_t v;
+    memcpy(&v, src, sizeof(v));
+    *(volatile uint32_t*)dst = v;
+  }
+  else
+    eCopyBlock(dst, src, size);
+}
+
+inline static void eFill(volatile void *dst, uint8_t c, size_t size)
+{
+  if(__builtin_constant_p(size) && size <= ECOPY_INLINE
+     && !(size & 7) && !((uintptr_t)dst & 7)) {
+    for(size_t i = 0; i < size; i += 8)
+      *(volatile uint64_t*)((volatile char*)dst + i) = 0x0101010101010101ull * c;
+  }
+  else
+    eFillBlock(dst, c, size);
+}
+
+#endif /* __EHAL_COPY__H */
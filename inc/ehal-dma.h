@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_DMA__H
+#define __EHAL_DMA__H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "state/ehal-state.h"
+
+//
+// Host driven transfers on an eCore's DMA engine.
+// Host reads of eCore SRAM travel as single read requests over the eLink and
+// reach a fraction of the write bandwidth. For larger reads the eCore's own
+// DMA engine pushes the SRAM into an eMem bounce buffer instead, the host then
+// reads it from DRAM. The channel is solely borrowed while idle and disabled,
+// i.e. not used by the eCore program.
+//
+// Beyond that, the host programs DMA transfers of any eCore: a descriptor
+// either goes straight into the channel's registers, or into the eCore's
+// SRAM, from where the engine fetches it (startup mode). Descriptors in SRAM
+// chain via next_ptr, so a whole sequence of moves between eMem and SRAM or
+// from core to core runs without the host in between.
+//
+#define EDMA_BOUNCE_MIN     0x800           // bytes, smaller reads go direct
+#define EDMA_CHANNEL        1               // channel borrowed for bounces
+#define EDMA_TIMEOUT_US     100000
+
+#define EDMA_MOVE_DESCS     4               // descriptors of an eDmaMove()
+
+// config, see eCoreDMA_t
+#define EDMA_CONFIG_ENABLE  (1u << 0)
+#define EDMA_CONFIG_MASTER  (1u << 1)
+#define EDMA_CONFIG_CHAIN   (1u << 2)
+#define EDMA_CONFIG_STARTUP (1u << 3)
+#define EDMA_CONFIG_IRQ     (1u << 4)
+#define EDMA_CONFIG_SIZE( log2 ) ((uint32_t)(log2) << 5)   // 0 byte .. 3 double
+#define EDMA_CONFIG_NEXT( desc ) ((uint32_t)(desc) << 16)
+// e-lib: E_DMA_ENABLE | E_DMA_MASTER | E_DMA_DWORD
+#define EDMA_CONFIG_DWORD   (EDMA_CONFIG_ENABLE | EDMA_CONFIG_MASTER | EDMA_CONFIG_SIZE( 3 ))
+
+// descriptor as fetched from SRAM in startup mode, e-lib's e_dma_desc_t.
+// The outer stride replaces the inner one after the last item of a row.
+typedef struct {
+  uint32_t config;
+  uint32_t inner_stride;            // dst << 16 | src, signed 16 bit each
+  uint32_t count;                   // outer << 16 | inner
+  uint32_t outer_stride;            // dst << 16 | src
+  uint32_t src_addr;
+  uint32_t dst_addr;
+} eDmaDesc_t;
+
+#define EDMA_STRIDE( dst, src ) ((((uint32_t)(dst) & 0xFFFF) << 16) | ((uint32_t)(src) & 0xFFFF))
+
+// All addresses as seen by the eCore, i.e. local (SRAM offsets) or global.
+// Starting fails (-1) if the channel is in use. Host threads starting on the
+// same eCore are serialized, the eCore program is not.
+
+// 1D descriptor of size bytes, as wide items as the alignment permits,
+// -1 if it takes more than 0xFFFF items
+int eDmaDescCopy(eDmaDesc_t *desc, uint32_t dst, uint32_t src, uint32_t size);
+
+// descriptor into the channel's registers, kicking it off. The register file
+// holds no outer stride, hence 2D and chained descriptors are rejected.
+int eDmaStartRegs(eCoreMemMap_t *eCore, unsigned chan, const eDmaDesc_t *desc);
+// one-shot double word transfer of size bytes
+int eDmaStart(eCoreMemMap_t *eCore, unsigned chan, uint32_t dst, uint32_t src, uint32_t size);
+
+// n descriptors into SRAM at offset (8 byte aligned), each chained to the
+// next one, the last one ends the chain
+int eDmaChain(eCoreMemMap_t *eCore, uint32_t offset, const eDmaDesc_t *descs, unsigned n);
+// fetch the descriptor at SRAM offset desc (8 byte aligned) and run it
+int eDmaStartDesc(eCoreMemMap_t *eCore, unsigned chan, uint32_t desc);
+
+// move of size bytes of any alignment: double words for the body, narrower
+// items for head and tail. Beyond a single descriptor, the chain gets built
+// at SRAM offset slot (room for EDMA_MOVE_DESCS). Wait with eDmaWait().
+int eDmaMove(eCoreMemMap_t *eCore, unsigned chan, uint32_t slot,
+             uint32_t dst, uint32_t src, size_t size);
+// 0 once the channel is idle, -1 on timeout
+int eDmaWait(eCoreMemMap_t *eCore, unsigned chan, unsigned long timeoutUs);
+
+// read from the SRAM of eCore, bounced through eMem from EDMA_BOUNCE_MIN on
+ssize_t eDmaRead(eConfig_t *cfg, eCoreMemMap_t *eCore, uint32_t offset, void *dst, size_t size);
+
+#endif /* __EHAL_DMA__H */
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_EMULATE__H
+#define __EHAL_EMULATE__H
+
+#include "state/ehal-state.h"
+
+//
+// EHAL_EMULATE=1 replaces the EPIPHANY device by a memfd, laid out as
+// the physical address space: eCores, esysregs, eMem and the Zynq ident
+// registers reside at the very same offsets. Hence all mmaps stay as is.
+// Registers solely hold their reset values (coreid, status, debugstatus,
+// DMA status, esysinfo), nothing executes.
+//
+int eEmuOpen(eConfig_t *cfg);
+// EHAL_EMULATE set to non-zero, i.e. EHAL_EMULATE=0 runs on hardware
+int eEmuRequested(void);
+
+#endif /* __EHAL_EMULATE__H */
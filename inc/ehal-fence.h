@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_FENCE__H
+#define __EHAL_FENCE__H
+
+//
+// Ordering of host stores towards the Epiphany.
+// A compiler barrier solely keeps gcc from moving accesses, the CPU is free
+// to post resp. merge them. On the Zynq the O_SYNC mappings of the eCores and
+// the eMem are strongly ordered, hence every single store waits for the
+// previous one, which costs the streaming writes their bandwidth. The
+// write-combined eMem aperture (eShmApertureOpen(ESHM_WRITECOMBINE), normal
+// non-cacheable memory) posts stores back-to-back, but neither orders them
+// among each other nor against the strongly ordered control writes.
+//
+// The relaxed bulk-store mode hence lasts from one fence to the next:
+//   stream     eMemStoreRelaxed() resp. stores into the aperture, any order
+//   fence      eFenceStore(), all of the above got posted before any store
+//              after it
+//   control    eStoreOrdered() on ilatst, debug.command, esysconfig, ...
+// eFenceComplete() in addition waits until the stores left the CPU, e.g.
+// ahead of a usleep() the Epiphany needs to settle after a reset.
+// On the Parallella there is no write-combined aperture (refused on ARMv7),
+// every store stays strongly ordered and solely the fences take effect.
+//
+
+#include <stdint.h>
+
+#define eFenceCompiler()    __asm__ volatile("" ::: "memory")
+
+#if defined(__aarch64__)
+# define eFenceStore()      __asm__ volatile("dmb oshst" ::: "memory")
+# define eFenceFull()       __asm__ volatile("dmb osh" ::: "memory")
+# define eFenceComplete()   __asm__ volatile("dsb sy" ::: "memory")
+#elif defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7
+// outer shareable does not cover the eLink, hence full system
+# define eFenceStore()      __asm__ volatile("dmb st" ::: "memory")
+# define eFenceFull()       __asm__ volatile("dmb sy" ::: "memory")
+# define eFenceComplete()   __asm__ volatile("dsb sy" ::: "memory")
+#elif defined(__x86_64__) || defined(__i386__)
+// stores are ordered already, apart from write-combined resp. non-temporal ones
+# define eFenceStore()      __builtin_ia32_sfence()
+# define eFenceFull()       __builtin_ia32_mfence()
+# define eFenceComplete()   __builtin_ia32_mfence()
+#else
+# define eFenceStore()      __atomic_thread_fence(__ATOMIC_RELEASE)
+# define eFenceFull()       __sync_synchronize()
+# define eFenceComplete()   __sync_synchronize()
+#endif
+
+// control register write, ordered after every store before it and before
+// every store after it
+inline static void eStoreOrdered(volatile void *reg, uint32_t val)
+{
+  eFenceStore();
+  *(volatile uint32_t*)reg = val;
+  eFenceStore();
+}
+
+#endif /* __EHAL_FENCE__H */
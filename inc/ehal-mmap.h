@@ -4,15 +4,30 @@
 #ifndef __EHAL_MMAP__H
 #define __EHAL_MMAP__H
 
+#include <stddef.h>
 #include "memmap-epiphany-cores.h"
 #include "state/ehal-state.h"
 
+void eMmapLocked(int locked);
+
 int eCoreMmap(int fd, eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd);
 int eCoreMunmap(eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd);
 
 int eShmMmap(int fd, __typeof__(&((eConfig_t*)0x0)->emem[0]) emem);
 int eShmMunmap(__typeof__(&((eConfig_t*)0x0)->emem[0]) emem);
 
+// 2nd aperture of the eMem, solely usable by the host
+int eShmCachedMmap(int fd, __typeof__(&((eConfig_t*)0x0)->emem[0]) emem, int mode);
+int eShmCachedMunmap(__typeof__(&((eConfig_t*)0x0)->emem[0]) emem);
+void eShmCacheClean(const void *addr, size_t size);
+void eShmCacheInvalidate(const void *addr, size_t size);
+
+// Whether the eCores [row, row+rows) x [col, col+cols) resp. [p, p+size) of
+// the eMem are mapped, i.e. within the lease of a broker client, else the
+// chip resp. the whole eMem. Anything beyond faults on access.
+int eCoresAreMapped(const eConfig_t *cfg, unsigned row, unsigned col, unsigned rows, unsigned cols);
+int eShmIsMapped(const __typeof__(((eConfig_t*)0x0)->emem[0]) *emem, const volatile void *p, size_t size);
+
 int eSysRegsMmap(int fd, eSysRegs* esys_regs_base);
 int eSysRegsMunmap(eSysRegs* esys_regs_base);
 
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_PAGER__H
+#define __EHAL_PAGER__H
+
+#include <stdint.h>
+#include "alloc/ehal-slab.h"
+
+//
+// Paging of a host-side dataset through eMem, e.g. to process inputs beyond
+// the 32 MB window. eMem holds a number of fixed-size slots which cache the
+// pages of the dataset:
+//   ePagerAcquire()   pins a page in a slot and returns its host / eCore
+//                     address, loading it first if needed
+//   ePagerRelease()   unpins it again, dirty pages are written back on eviction
+// While the eCores work on acquired pages, a background thread prefetches the
+// next `readahead` pages (or whatever ePagerPrefetch() asked for) into slots
+// chosen by the eviction policy.
+//
+
+typedef struct {
+  // fill dst with `size` bytes of page `page`, 0 on success
+  int (*fetch)(void *ctx, uint64_t page, uint64_t offset, void *dst, uint32_t size);
+  // optional, store a dirty page back, 0 on success
+  int (*writeback)(void *ctx, uint64_t page, uint64_t offset, const void *src, uint32_t size);
+  void *ctx;
+} ePagerSource_t;
+
+// dataset in host memory resp. in a file (pread/pwrite)
+ePagerSource_t ePagerSourceMem(void *base);
+ePagerSource_t ePagerSourceFd(int fd);
+
+typedef struct {
+  void* (*init)(unsigned slots);
+  void (*fini)(void *state);
+  void (*insert)(void *state, unsigned slot);   // slot got a new page
+  void (*touch)(void *state, unsigned slot);    // page in slot got acquired
+  // choose among slots with evictable[slot] != 0, -1 if none
+  int (*victim)(void *state, unsigned slots, const uint8_t *evictable);
+} ePagerPolicy_t;
+
+extern const ePagerPolicy_t ePagerLru;
+extern const ePagerPolicy_t ePagerFifo;
+
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;                  // acquire had to load synchronously
+  uint64_t prefetched;
+  uint64_t evictions;
+  uint64_t writebacks;
+} ePagerStats_t;
+
+typedef struct ePager_s ePager_t;
+
+ePager_t* ePagerCreate(const ePagerSource_t *src, uint64_t size,
+                       uint32_t pageSize, unsigned slots, unsigned readahead,
+                       const ePagerPolicy_t *policy);
+void ePagerDestroy(ePager_t *pager);
+
+int ePagerAcquire(ePager_t *pager, uint64_t page, eMemPtr_t *p);
+void ePagerRelease(ePager_t *pager, uint64_t page, int dirty);
+void ePagerPrefetch(ePager_t *pager, uint64_t page);
+
+// write back all dirty pages
+int ePagerFlush(ePager_t *pager);
+
+uint64_t ePagerPages(const ePager_t *pager);
+void ePagerGetStats(ePager_t *pager, ePagerStats_t *stats);
+
+#endif /* __EHAL_PAGER__H */
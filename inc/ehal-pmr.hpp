@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_PMR__HPP
+#define __EHAL_PMR__HPP
+
+//
+// std::pmr memory resources over the eMem heap (C++17).
+//   ehal::EMemResource        eMemAlloc()/eMemFree(), i.e. the slab, thread
+//                             caches and mspace of libehal
+//   ehal::EMemMonotonic       bump arena with EMemResource as upstream,
+//                             frees nothing until release() / destruction
+// As eMem is mapped at epi_base, pointers inside such containers are valid
+// eCore addresses as well. That said, a 64-bit host lays out pointers
+// differently than the 32-bit eCores, hence solely containers of plain data
+// with offset or eaddr links are to be shared there.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+extern "C" {
+#include "ehal.h"
+}
+
+namespace ehal {
+
+class EMemResource final : public std::pmr::memory_resource {
+private:
+  void* do_allocate(std::size_t bytes, std::size_t align) override
+  {
+    // a power of two class is aligned to its size, large buffers to a page
+    if(bytes > ESLAB_MAX && align > ESLAB_LARGE_ALIGN)
+      throw std::bad_alloc();
+    void *p = eMemAlloc(bytes < align ? align : bytes).host;
+    if(!p)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  void do_deallocate(void *p, std::size_t, std::size_t) override
+  {
+    eMemFree(p);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+  {
+    // there is a single eMem heap
+    return dynamic_cast<const EMemResource*>(&other) != nullptr;
+  }
+};
+
+inline EMemResource* eMemResource() noexcept
+{
+  static EMemResource res;
+  return &res;
+}
+
+class EMemMonotonic : public std::pmr::monotonic_buffer_resource {
+public:
+  EMemMonotonic() : std::pmr::monotonic_buffer_resource(eMemResource()) {}
+  explicit EMemMonotonic(std::size_t initial)
+    : std::pmr::monotonic_buffer_resource(initial, eMemResource()) {}
+};
+
+// address translation host <-> eCores
+template<typename T>
+inline std::uint32_t toEpi(const T *p) noexcept
+{
+  return eMemHostToEpi(eMemRegion(), p);
+}
+
+template<typename T>
+inline T* toHost(std::uint32_t eaddr) noexcept
+{
+  return static_cast<T*>(eMemEpiToHost(eMemRegion(), eaddr));
+}
+
+template<typename T>
+inline bool inEMem(const T *p) noexcept
+{
+  const eConfigMem_t *emem = eMemRegion();
+  const char *c = reinterpret_cast<const char*>(p);
+  return c >= emem->epi_base && c < emem->epi_base + emem->size;
+}
+
+} // namespace ehal
+
+#endif /* __EHAL_PMR__HPP */
@@ -38,12 +38,12 @@ extern unsigned eloglevel;
 #define eCorePrintf( dbg, eCore, format, ... ) \
 ({ \
   if(__builtin_expect(eloglevel >= dbg, 0)) { \
-    fprintf (stdout, "[%2d,%2d] " format, ECORE_ADDR_ROWID(eCore), ECORE_ADDR_COLID(eCore), ##__VA_ARGS__); \
+    fprintf (stdout, "[%2d,%2d] " format, (int)ECORE_ADDR_ROWID(eCore), (int)ECORE_ADDR_COLID(eCore), ##__VA_ARGS__); \
   } \
 })
 #define eCoreError( eCore, format, ... ) \
 ({ \
-  fprintf (stderr, "[%2d,%2d] ERR: " format, ECORE_ADDR_ROWID(eCore), ECORE_ADDR_COLID(eCore), ##__VA_ARGS__); \
+  fprintf (stderr, "[%2d,%2d] ERR: " format, (int)ECORE_ADDR_ROWID(eCore), (int)ECORE_ADDR_COLID(eCore), ##__VA_ARGS__); \
 })
 
 
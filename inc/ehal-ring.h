@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_RING__H
+#define __EHAL_RING__H
+
+//
+// Lock-free ring buffer of fixed-size slots, placed in eMem or in an eCore's
+// SRAM. The slots follow the header, so the ring is position independent and
+// host and eCores use it through their own address of it. head (consumer)
+// and tail (producer) live on cache lines of their own, hence a cached host
+// mapping does not bounce them between both sides.
+//
+// Each side keeps its position and the last seen index of the other side in
+// an eRingPort_t in its own memory. The shared indices are only read once
+// the cached view runs out, and written once per batch:
+//   producer   n = eRingReserve(&port, want);  fill eRingAt(&port, 0..n-1);
+//              eRingCommit(&port, n);
+//   consumer   n = eRingPeek(&port, want);     read eRingAt(&port, 0..n-1);
+//              eRingRelease(&port, n);
+//
+// Rings created with ERING_MPSC take several producers on the host side,
+// these claim slots with eRingClaim() and publish them in claim order with
+// eRingPublish(). The consumer side stays the same. eCores have no atomics
+// on eMem, so every producing eCore gets a SPSC ring of its own.
+//
+// The header builds with e-gcc as well, creation is meant for the host.
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#define ERING_MAGIC         0x474e4952      // "RING"
+#define ERING_LINE          64
+#define ERING_MPSC          0x1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t mask;                    // slots - 1
+  uint32_t slotSize;                // bytes
+  uint32_t flags;                   // ERING_*
+  uint8_t __pad0[ERING_LINE - 4 * sizeof(uint32_t)];
+
+  volatile uint32_t head;           // consumer, next slot to read
+  uint8_t __pad1[ERING_LINE - sizeof(uint32_t)];
+
+  volatile uint32_t tail;           // producer, next slot to publish
+  volatile uint32_t claim;          // ERING_MPSC, next slot to hand out
+  uint8_t __pad2[ERING_LINE - 2 * sizeof(uint32_t)];
+} eRing_t;
+
+typedef struct {
+  eRing_t *ring;
+  uint32_t pos;                     // own index
+  uint32_t limit;                   // own index must stay below, last seen view
+} eRingPort_t;
+
+#ifdef __epiphany__
+// eMesh writes from one source to one destination arrive in order, solely
+// gcc must not move the slot accesses across
+# define eRingLoadAcq( p ) \
+({ \
+  __typeof__(*(p) + 0) __v = *(p); \
+  __asm__ __volatile__("" ::: "memory"); \
+  __v; \
+})
+# define eRingStoreRel( p, v ) \
+({ \
+  __asm__ __volatile__("" ::: "memory"); \
+  *(p) = (v); \
+})
+#else
+# define eRingLoadAcq( p )          __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define eRingStoreRel( p, v )      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+// bytes a ring of `slots` slots takes, slots has to be a power of 2
+#define eRingBytes( slots, slotSize ) (sizeof(eRing_t) + (uint32_t)(slots) * (uint32_t)(slotSize))
+
+inline static uint32_t eRingSlots(const eRing_t *ring)
+{
+  return ring->mask + 1;
+}
+
+inline static void* eRingSlot(const eRing_t *ring, uint32_t idx)
+{
+  return (char*)(ring + 1) + (idx & ring->mask) * ring->slotSize;
+}
+
+inline static int eRingValid(const eRing_t *ring)
+{
+  return ring->magic == ERING_MAGIC && !(ring->mask & (ring->mask + 1));
+}
+
+// ---- producer ----
+
+inline static eRingPort_t eRingProducer(eRing_t *ring)
+{
+  eRingPort_t port = { ring, ring->tail, eRingLoadAcq(&ring->head) + ring->mask + 1 };
+  return port;
+}
+
+// up to n free slots starting at eRingAt(port, 0)
+inline static uint32_t eRingReserve(eRingPort_t *port, uint32_t n)
+{
+  uint32_t avail = port->limit - port->pos;
+  if(avail < n) {
+    port->limit = eRingLoadAcq(&port->ring->head) + port->ring->mask + 1;
+    avail = port->limit - port->pos;
+  }
+  return avail < n ? avail : n;
+}
+
+inline static void eRingCommit(eRingPort_t *port, uint32_t n)
+{
+  port->pos += n;
+  eRingStoreRel(&port->ring->tail, port->pos);
+}
+
+// ---- consumer ----
+
+inline static eRingPort_t eRingConsumer(eRing_t *ring)
+{
+  eRingPort_t port = { ring, ring->head, eRingLoadAcq(&ring->tail) };
+  return port;
+}
+
+// up to n filled slots starting at eRingAt(port, 0)
+inline static uint32_t eRingPeek(eRingPort_t *port, uint32_t n)
+{
+  uint32_t avail = port->limit - port->pos;
+  if(avail < n) {
+    port->limit = eRingLoadAcq(&port->ring->tail);
+    avail = port->limit - port->pos;
+  }
+  return avail < n ? avail : n;
+}
+
+inline static void eRingRelease(eRingPort_t *port, uint32_t n)
+{
+  port->pos += n;
+  eRingStoreRel(&port->ring->head, port->pos);
+}
+
+// ---- both ----
+
+#define eRingAt( port, i )          eRingSlot((port)->ring, (port)->pos + (i))
+
+// single slot copies, 0 if the ring is full resp. empty
+inline static int eRingPush(eRingPort_t *port, const void *src)
+{
+  if(!eRingReserve(port, 1))
+    return 0;
+  memcpy(eRingAt(port, 0), src, port->ring->slotSize);
+  eRingCommit(port, 1);
+  return 1;
+}
+
+inline static int eRingPop(eRingPort_t *port, void *dst)
+{
+  if(!eRingPeek(port, 1))
+    return 0;
+  memcpy(dst, eRingAt(port, 0), port->ring->slotSize);
+  eRingRelease(port, 1);
+  return 1;
+}
+
+#ifndef __epiphany__
+
+#include <sched.h>
+
+#if defined(__arm__) || defined(__aarch64__)
+# define eRingSpin()                __asm__ __volatile__("yield")
+#elif defined(__x86_64__) || defined(__i386__)
+# define eRingSpin()                __builtin_ia32_pause()
+#else
+# define eRingSpin()                do {} while(0)
+#endif
+
+inline static eRing_t* eRingInit(void *mem, uint32_t slots, uint32_t slotSize, unsigned flags)
+{
+  eRing_t *ring = (eRing_t*)mem;
+  if(!ring || !slots || (slots & (slots - 1)) || !slotSize)
+    return (eRing_t*)0;
+  memset(ring, 0, sizeof(*ring));
+  ring->mask = slots - 1;
+  ring->slotSize = slotSize;
+  ring->flags = flags;
+  __atomic_store_n(&ring->magic, ERING_MAGIC, __ATOMIC_RELEASE);
+  return ring;
+}
+
+// ERING_MPSC: all or nothing, returns n and the first index or 0 if full
+inline static uint32_t eRingClaim(eRing_t *ring, uint32_t n, uint32_t *idx)
+{
+  uint32_t claim = __atomic_load_n(&ring->claim, __ATOMIC_RELAXED);
+  do {
+    if(eRingLoadAcq(&ring->head) + ring->mask + 1 - claim < n)
+      return 0;
+  } while(!__atomic_compare_exchange_n(&ring->claim, &claim, claim + n, 1,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  *idx = claim;
+  return n;
+}
+
+// ERING_MPSC: slots idx .. idx+n-1 are filled, waits for the earlier claims,
+// yields once a preempted producer is likely to hold them up
+inline static void eRingPublish(eRing_t *ring, uint32_t idx, uint32_t n)
+{
+  for(unsigned spin = 0; eRingLoadAcq(&ring->tail) != idx; ++spin)
+    if(spin < 64)
+      eRingSpin();
+    else
+      sched_yield();
+  eRingStoreRel(&ring->tail, idx + n);
+}
+
+#endif /* __epiphany__ */
+
+#endif /* __EHAL_RING__H */
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_SHADOW__H
+#define __EHAL_SHADOW__H
+
+#include <stdint.h>
+#include "memmap-epiphany-cores.h"
+
+//
+// Host side shadows of write-mostly eCore registers: config, imask,
+// meshconfig and the DMA channels' config.
+// A bitfield update such as eCore->regs.config.lpmode = 1 reads the register
+// over the eLink (slow direction, the host stalls for the round trip) and
+// writes it back. Against the shadow it becomes a single posted store, the
+// register solely gets read on the first access.
+// The shadow holds as long as solely the host writes these registers, i.e.
+// until the eCore program ran resp. the DMA engine fetched descriptors. Then
+// eRegForgetCore() resp. eRegForget().
+// Other registers pass through, updates of them stay read-modify-write.
+//
+// Register writes to many eCores collect in a batch and leave ordered by
+// eCore (ascending addresses), in program order per eCore, hence as one burst
+// per eCore.
+//
+
+// reg is a 32 bit register as mapped by the host, void as the register
+// structs are packed
+
+// store, keeping the shadow in sync
+void eRegStore(volatile void *reg, uint32_t val);
+// shadowed value, read over the eLink solely the first time
+uint32_t eRegLoad(volatile void *reg);
+// bits of mask to bits, a single store for shadowed registers
+void eRegUpdate(volatile void *reg, uint32_t mask, uint32_t bits);
+void eRegForget(volatile void *reg);
+void eRegForgetCore(eCoreMemMap_t *eCore);
+void eRegShadowFini(void);
+
+// mask resp. bits of field of a register declared by EREG_BITFIELD_MACRO
+#define EREG_FIELD_MASK( regunion, field ) \
+({ \
+  __typeof__(regunion) _f = { .reg = 0 }; \
+  _f.field = ~_f.field; \
+  (uint32_t)_f.reg; \
+})
+#define EREG_FIELD_BITS( regunion, field, val ) \
+({ \
+  __typeof__(regunion) _f = { .reg = 0 }; \
+  _f.field = (val); \
+  (uint32_t)_f.reg; \
+})
+// e.g. eRegSetField( eCore->regs.config, lpmode, 1 )
+#define eRegSetField( regunion, field, val ) \
+  eRegUpdate( &(regunion).reg, EREG_FIELD_MASK( regunion, field ), \
+              EREG_FIELD_BITS( regunion, field, val ) )
+
+typedef struct {
+  volatile uint32_t *reg;
+  uint32_t val;
+} eRegWrite_t;
+
+typedef struct {
+  eRegWrite_t *w;
+  unsigned n, max;
+} eRegBatch_t;
+
+#define EREG_BATCH_INIT( buf ) { (buf), 0, sizeof(buf) / sizeof((buf)[0]) }
+
+// queued, the shadow is updated at once, flushes itself once full
+void eRegBatchStore(eRegBatch_t *batch, volatile void *reg, uint32_t val);
+void eRegBatchUpdate(eRegBatch_t *batch, volatile void *reg, uint32_t mask, uint32_t bits);
+void eRegBatchFlush(eRegBatch_t *batch);
+
+#define eRegBatchSetField( batch, regunion, field, val ) \
+  eRegBatchUpdate( (batch), &(regunion).reg, EREG_FIELD_MASK( regunion, field ), \
+                   EREG_FIELD_BITS( regunion, field, val ) )
+
+#endif /* __EHAL_SHADOW__H */
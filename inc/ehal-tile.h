@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_TILE__H
+#define __EHAL_TILE__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "state/ehal-state.h"
+
+//
+// 2D tiles of a row-major host matrix, distributed over a workgroup: eCore
+// (r,c) of the group holds the tileRows x tileCols elements starting at
+// matrix row r * tileRows and column c * tileCols, packed row-major at the
+// same SRAM offset on every eCore. The matrix hence spans
+// rows * tileRows x cols * tileCols elements.
+//
+// The host walks the eCores in ascending address order. Tile rows are staged
+// so that every eCore receives one ascending burst of 64-bit writes, and
+// gathers read a whole tile at once (bounced through eMem by the eCore's DMA,
+// see ehal-dma.h).
+// With dma set and the matrix in eMem, the eCores' DMA engines move their
+// tile themselves in 2D mode (rows as the outer loop), the host solely writes
+// the descriptors. This needs 8 byte aligned rows, strides and offsets, else
+// (and emulated) the host copies.
+//
+#define ETILE_STAGE         0x1000          // bytes of tile rows staged at once
+
+typedef struct {
+  unsigned row, col;                // first eCore of the group within the chip
+  unsigned rows, cols;              // group geometry
+  uint32_t offset;                  // SRAM offset of the tile
+  unsigned tileRows, tileCols;      // elements
+  unsigned elem;                    // bytes per element
+  size_t stride;                    // bytes between matrix rows, 0 if packed
+  int dma;                          // let the eCores' DMA engines move the tiles
+  uint32_t desc;                    // SRAM offset of the descriptor (24 bytes)
+} eTile_t;
+
+// bytes moved, -1 if the tiles exceed the group or SRAM (nothing moved then)
+ssize_t eTileScatter(eConfig_t *cfg, const eTile_t *tile, const void *matrix);
+ssize_t eTileGather(eConfig_t *cfg, const eTile_t *tile, void *matrix);
+
+#endif /* __EHAL_TILE__H */
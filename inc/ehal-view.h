@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_VIEW__H
+#define __EHAL_VIEW__H
+
+//
+// Zero-copy views into the SRAM of an eCore resp. an eMem buffer. As the host
+// maps both at the addresses the eCores use, kernel data structures get read
+// and written in place, without offsets and temporary buffers:
+//   eView_t v = eCoreView(row, col, 0x4000, n * sizeof(args_t));
+//   eViewAt( v, args_t, i ).count = 42;
+// Bounds get checked by assert(), i.e. solely in debug builds, the views
+// themselves are checked on creation (eCoreView(), eMemView()).
+// Each access is a single load resp. store over the eLink. Bulk transfers
+// still are faster through eCopy() (64-bit ascending bursts), the ordering
+// against the eCores stays with ehal-fence.h.
+// See ehal-view.hpp for the typed C++ counterpart (std::span alike).
+//
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  void *base;                       // host VA, equals the Epiphany address
+  size_t size;                      // bytes, 0 for an invalid view
+} eView_t;
+
+// size bytes at offset within the view
+inline static void* eViewPtr(eView_t view, size_t offset, size_t size)
+{
+  assert( view.base );
+  assert( offset <= view.size && size <= view.size - offset );
+  return (char*)view.base + offset;
+}
+
+inline static eView_t eViewSub(eView_t view, size_t offset, size_t size)
+{
+  return (eView_t){ eViewPtr(view, offset, size), size };
+}
+
+inline static uint32_t eViewEpi(eView_t view)
+{
+  return (uint32_t)(uintptr_t)view.base;
+}
+
+// element idx of an array of type, e.g. eViewAt( v, volatile uint32_t, 3 ) = 1
+#define eViewAt( view, type, idx ) \
+  (*(type*)eViewPtr( (view), (size_t)(idx) * sizeof(type), sizeof(type) ))
+#define eViewCount( view, type )   ((view).size / sizeof(type))
+
+#endif /* __EHAL_VIEW__H */
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_VIEW__HPP
+#define __EHAL_VIEW__HPP
+
+//
+// Typed zero-copy views into eCore SRAM resp. eMem (C++17), shaped after
+// std::span:
+//   auto args = ehal::coreView<args_t>(row, col, 0x4000, n);
+//   for(auto &a : args) a.count = 42;
+//   auto out = ehal::memView<float>(eMemAlloc(n * sizeof(float)).host, n);
+// Element accesses and subviews are bounds checked by assert() solely, i.e.
+// in debug builds. Creation checks the region and the alignment of T always,
+// a failed one gives an empty view.
+// T is plain data as laid out for the eCores; volatile T for locations the
+// eCores change while the host looks at them.
+//
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+extern "C" {
+#include "ehal.h"
+}
+
+namespace ehal {
+
+template<typename T>
+class View {
+  static_assert(std::is_trivially_copyable_v<std::remove_cv_t<T>>,
+                "eCores share plain data solely");
+
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using size_type = std::size_t;
+  using pointer = T*;
+  using reference = T&;
+  using iterator = T*;
+
+  constexpr View() noexcept = default;
+  constexpr View(T *data, size_type count) noexcept : data_(data), count_(count) {}
+  // of the C view, whole elements solely
+  explicit View(const eView_t &view) noexcept
+  {
+    if(view.base && !(reinterpret_cast<std::uintptr_t>(view.base) % alignof(T))) {
+      data_ = static_cast<T*>(view.base);
+      count_ = view.size / sizeof(T);
+    }
+  }
+
+  constexpr T* data() const noexcept { return data_; }
+  constexpr size_type size() const noexcept { return count_; }
+  constexpr size_type size_bytes() const noexcept { return count_ * sizeof(T); }
+  constexpr bool empty() const noexcept { return !count_; }
+
+  constexpr iterator begin() const noexcept { return data_; }
+  constexpr iterator end() const noexcept { return data_ + count_; }
+
+  T& operator[](size_type idx) const noexcept
+  {
+    assert( idx < count_ );
+    return data_[idx];
+  }
+  T& front() const noexcept { return (*this)[0]; }
+  T& back() const noexcept { return (*this)[count_ - 1]; }
+
+  View first(size_type count) const noexcept
+  {
+    assert( count <= count_ );
+    return View(data_, count);
+  }
+  View last(size_type count) const noexcept
+  {
+    assert( count <= count_ );
+    return View(data_ + count_ - count, count);
+  }
+  View subview(size_type offset, size_type count) const noexcept
+  {
+    assert( offset <= count_ && count <= count_ - offset );
+    return View(data_ + offset, count);
+  }
+
+  // the same bytes as the eCores address them
+  std::uint32_t eaddr() const noexcept
+  {
+    return static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(data_));
+  }
+  eView_t c() const noexcept
+  {
+    return { const_cast<value_type*>(data_), size_bytes() };
+  }
+
+private:
+  T *data_ = nullptr;
+  size_type count_ = 0;
+};
+
+// count elements at offset of the SRAM of eCore (row, col) of the chip
+template<typename T>
+inline View<T> coreView(unsigned row, unsigned col, std::uint32_t offset, std::size_t count) noexcept
+{
+  return View<T>(eCoreView(row, col, offset, count * sizeof(T)));
+}
+
+// count elements at host within the eMem, e.g. of eMemAlloc() resp. e_alloc()
+template<typename T>
+inline View<T> memView(void *host, std::size_t count) noexcept
+{
+  return View<T>(eMemView(host, count * sizeof(T)));
+}
+
+} // namespace ehal
+
+#endif /* __EHAL_VIEW__HPP */
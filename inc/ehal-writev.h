@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_WRITEV__H
+#define __EHAL_WRITEV__H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "state/ehal-state.h"
+
+//
+// Scatter-gather writes into the SRAM of many eCores at once, e.g. kernel
+// arguments of a whole group. The items get sorted by their global address
+// (hence by eCore and offset), adjoining or overlapping items of an eCore are
+// merged in a host staging buffer, and every merged run leaves as one
+// ascending eCopy() burst. Overlaps resolve like the sequence of single
+// writes would, later items win.
+// Vectors which are ascending and free of overlaps already, and smaller than
+// EWRITEV_PIPELINE, skip all of that and leave item by item.
+// From EWRITEV_PIPELINE bytes on, a writer thread drains the runs over the
+// eLink while the calling thread still merges the following ones.
+//
+#define EWRITEV_PIPELINE    0x10000         // bytes
+#define EWRITEV_QUEUE       64              // runs in flight
+
+typedef struct {
+  unsigned row, col;                // eCore within the chip
+  uint32_t offset;                  // SRAM offset
+  const void *buf;
+  size_t size;
+} eWriteVec_t;
+
+// bytes written, -1 if an item is out of bounds (nothing got written then)
+ssize_t eWritev(eConfig_t *cfg, const eWriteVec_t *vec, unsigned n);
+
+#endif /* __EHAL_WRITEV__H */
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL__H
+#define __EHAL__H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "state/ehal-state.h"
+#include "alloc/ehal-slab.h"
+#include "alloc/ehal-stats.h"
+#include "ehal-arena.h"
+#include "ehal-ring.h"
+#include "ehal-fence.h"
+#include "ehal-writev.h"
+#include "ehal-async.h"
+#include "ehal-bulk.h"
+#include "ehal-shadow.h"
+#include "ehal-tile.h"
+#include "ehal-view.h"
+
+// Bootstrap timing, filled once libehal got loaded.
+unsigned long eCoresBootPhaseUs(eBootPhase_t phase);
+unsigned long eCoresBootUs(void);
+const char* eBootPhaseToStr(eBootPhase_t phase);
+
+// Optional 2nd aperture of the eMem (ESHM_CACHED or ESHM_WRITECOMBINE).
+// Host accesses through it run at DRAM speed, coherency with the eCores
+// needs to be established explicitly:
+//   eShmFlush()      after the host wrote, before eCores read (clean)
+//   eShmInvalidate() after eCores wrote, before the host reads (invalidate)
+// Refused (NULL) on ARMv7, i.e. the Parallella: the eMem is mapped strongly
+// ordered regardless and there is no by-VA maintenance of the L2 (PL310).
+char* eShmApertureOpen(int mode);
+void eShmApertureClose(void);
+void eShmFlush(const void *addr, size_t size);
+void eShmInvalidate(const void *addr, size_t size);
+#define eShmApertureToEpi( emem, p ) ((emem)->epi_base + ((char*)(p) - (emem)->cached_base))
+#define eShmEpiToAperture( emem, p ) ((emem)->cached_base + ((char*)(p) - (emem)->epi_base))
+
+// Relaxed bulk store into the eMem (dst as the Epiphany sees it): through the
+// aperture if it is known to be write-combined (ESHM_WRITECOMBINE of /dev/mem
+// on arm64, RAM of the kernel), posted back-to-back and in any order, else
+// eCopy(). Solely the next eFenceStore() resp. eStoreOrdered() orders it, see
+// ehal-fence.h. On the Parallella (ARMv7) the aperture is refused and the eMem
+// strongly ordered, hence solely the fences take effect there.
+void eMemStoreRelaxed(volatile void *dst, const void *src, size_t size);
+
+// Read from the SRAM of eCore (row, col) of the chip. Reads of
+// EDMA_BOUNCE_MIN bytes and more get pushed into eMem by the eCore's DMA
+// engine and read from DRAM, see ehal-dma.h.
+ssize_t eCoreRead(unsigned row, unsigned col, uint32_t offset, void *dst, size_t size);
+
+// In place views of size bytes at offset of the SRAM of eCore (row, col) of
+// the chip resp. at host within the eMem, see ehal-view.h.
+// An empty view (base NULL) if they exceed the SRAM resp. eMem.
+eView_t eCoreView(unsigned row, unsigned col, uint32_t offset, size_t size);
+eView_t eMemView(void *host, size_t size);
+
+// moves on the DMA engine of eCore (row, col) of the chip, see ehal-dma.h
+int eCoreDmaMove(unsigned row, unsigned col, unsigned chan, uint32_t slot,
+                 uint32_t dst, uint32_t src, size_t size);
+int eCoreDmaWait(unsigned row, unsigned col, unsigned chan);
+
+// scattered writes into the SRAM of eCores of the chip, merged into
+// ascending bursts, see ehal-writev.h
+ssize_t eCoreWritev(const eWriteVec_t *vec, unsigned n);
+
+// 2D tiles of a row-major matrix into resp. out of the SRAM of a group of
+// eCores, see ehal-tile.h
+ssize_t eCoreTileScatter(const eTile_t *tile, const void *matrix);
+ssize_t eCoreTileGather(const eTile_t *tile, void *matrix);
+
+// eMem buffers from the slab allocator: 8 byte aligned up to 32 bytes,
+// 64 byte (DMA) aligned up to 2KB, 4KB aligned above.
+// Thread-safe, each thread allocates from its own cache first.
+eMemPtr_t eMemAlloc(size_t size);
+void eMemFree(void *host);
+
+// eMem at an exact offset (relative to epi_base) for eCore kernels that
+// expect their data at a fixed address. Overlaps are rejected, so is an
+// offset occupied by live eMemAlloc() buffers. The region area at the top
+// of the eMem (from 0x01000000 on by default) is kept free of the heap, see
+// alloc/ehal-region.h.
+eMemPtr_t eMemReserve(uint32_t offset, size_t size);
+int eMemRelease(uint32_t offset);
+
+// eMem the above hands out, e.g. for eMemHostToEpi() / eMemEpiToHost()
+const eConfigMem_t* eMemRegion(void);
+
+// offset based arena in eMem, see ehal-arena.h
+eArena_t* eMemArenaCreate(uint32_t size);
+void eMemArenaDestroy(eArena_t *arena);
+
+// ring buffer in eMem, see ehal-ring.h. Rings in eCore SRAM get set up
+// with eRingInit() on the SRAM instead.
+eRing_t* eMemRingCreate(uint32_t slots, uint32_t slotSize, unsigned flags);
+void eMemRingDestroy(eRing_t *ring);
+
+// eMem heap usage, e.g. to size jobs against the eMem window
+int eMemStats(eMemStats_t *stats);
+void eMemStatsPrint(FILE *out);
+
+// Trace of the most recent eMemAlloc()/eMemFree() calls, entries must be a
+// power of 2 and stay the same on later starts, the ring keeps its size
+// until eCoresFini(). Costs a clock_gettime() per call while running, nothing
+// else.
+int eMemTraceStart(unsigned entries);
+void eMemTraceStop(void);
+size_t eMemTraceRead(eMemTrace_t *out, size_t n);
+
+#endif /* __EHAL__H */
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#ifndef __EHAL_DATA_LOADER__H
+#define __EHAL_DATA_LOADER__H
+
+#include <sys/types.h>
+
+//
+// File contents straight into resp. out of the mapped eMem, without staging
+// through a host buffer. Transfers run in EDATA_CHUNK pieces, O_DIRECT for
+// the EDATA_ALIGN aligned part where file system and mapping allow for it,
+// buffered pread/pwrite otherwise (still a single copy).
+// size 0 on load means up to the end of the file.
+//
+#define EDATA_CHUNK         0x100000
+#define EDATA_ALIGN         0x1000
+
+ssize_t load_data(const char *fname, off_t foff, void *dst, size_t size);
+ssize_t store_data(const char *fname, off_t foff, const void *src, size_t size);
+
+// same in a background thread, data_wait() returns what the transfer did
+typedef struct edata_job_s edata_job_t;
+edata_job_t* load_data_async(const char *fname, off_t foff, void *dst, size_t size);
+edata_job_t* store_data_async(const char *fname, off_t foff, const void *src, size_t size);
+ssize_t data_wait(edata_job_t *job);
+
+#endif /* __EHAL_DATA_LOADER__H */
@@ -9,5 +9,8 @@
 int parse_srec(unsigned char *srecBgn, unsigned char *srecEnd,
                eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd);
 int load_srec(const char *srecFile, eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd);
+// SRAM range [localBgn, localEnd) the eCore local records of srecFile
+// occupy, e.g. to reserve it in the bank planner (ehal-banks.h)
+int extent_srec(const char *srecFile, uint32_t *localBgn, uint32_t *localEnd);
 
 #endif /* __EHAL_SREC_LOADER__PUBLIC_API__H */
@@ -35,6 +35,19 @@ typedef enum
 #define ELINK_REG_CHIPHALT  ELINK_REG_WEST
 #define ELINK_REG_MASK( x ) ( ((x) << 2) | 0x1 )
 
+// Phases of eCoresBootstrap, each one is timed individually
+typedef enum
+{
+  EBOOT_HDF = 0,                    // HDF parse
+  EBOOT_DEVICE,                     // device open (or broker lease)
+  EBOOT_SYSREGS,                    // FPGA sysregs mmap and chip identification
+  EBOOT_CORES,                      // eCores mmap
+  EBOOT_ELINK,                      // east eLink up
+  EBOOT_SHM,                        // eMem mmap
+  EBOOT_MSPACE,                     // eMem heap creation
+  EBOOT_PHASES
+} eBootPhase_t;
+
 // 
 // This is the minimal state that needs to be present to bootstrap.
 // 
@@ -52,18 +65,32 @@ typedef struct {
   eCoreMemMap_t *eCoreCfg[4];       //*                                   └> North, East, South, West
 } eConfigChip_t;
 
+// modes of the optional 2nd eMem aperture (cached_mode)
+#define ESHM_CACHED         0x1     // cacheable, write back
+#define ESHM_WRITECOMBINE   0x2     // non-cacheable, but bufferable
+
 typedef struct {
   uintptr_t base_address;           //*                       0x3e000000
   char* epi_base;                   //*                       0x8e000000
   uint32_t size;                    //*                       0x02000000
   int prot;                         //* EMEM_TYPE                   RDWR  -> PROT_READ|PROT_WRITE
+  uint32_t pagesize;                // -- page size the mapping is backed with (4K or 2M)
+  uint32_t map_offset;              // -- mapped range relative to epi_base,
+  uint32_t map_size;                //    the whole eMem unless leased
+  char* cached_base;                // -- optional 2nd (cached/WC) mapping, see eShmApertureOpen
+  int cached_mode;
+  int cached_wc;                    // -- the mapping is known to be write-combined
 
   mspace space;
+  struct eSlabHeap_s *slab;         // -- size-class front-end of space, see alloc/ehal-slab.h
+  struct eRegions_s *regions;       // -- reserved offsets beside space, see alloc/ehal-region.h
 } eConfigMem_t;
 
 typedef struct
 {
   int fd;                           // -- file descriptor of EPIPHANY
+  unsigned emulated;                // -- fd is a memfd, see EHAL_EMULATE
+  unsigned leased;                  // -- fd is of a broker, solely the lease is mapped
                                     // PLATFORM_VERSION   PARALLELLA1601
   eSysRegs* esys_regs_base;         //*                       0x808f0f00  -> 0x808f0000
 
@@ -75,6 +102,8 @@ typedef struct
                                     // EMEM                     ext-DRAM
   eConfigMem_t emem[1];
   eConfigMem_t *lemem;
+
+  unsigned long bootUs[EBOOT_PHASES]; // -- duration of each bootstrap phase
 } eConfig_t;
 
 #endif /* __EHAL_STATE__H */
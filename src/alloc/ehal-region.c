@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _POSIX_C_SOURCE 200809L /* pthread_rwlock_t */
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc/ehal-region.h"
+#include "alloc/ehal-slab.h"
+#include "alloc/ehal-stats.h"
+#include "alloc/ehal-tcache.h"
+#include "ehal-print.h"
+
+// mspace footprint granularity, also keeps the slabs aligned
+#define EREGION_PAGE        ESLAB_SIZE
+
+typedef struct {
+  uint32_t offset;                  // relative to epi_base
+  uint32_t size;
+} eRegion_t;
+
+typedef struct eRegions_s {
+  pthread_mutex_t lock;
+  pthread_rwlock_t heap;            // shared by the heap's users, exclusive by a rebuild
+  uint32_t arenaOff, arenaSize;     // what reservations and the heap may span
+  uint32_t areaOff;                 // region area, up to the arena's end
+  uint32_t heapOff, heapSize;       // current span of the mspace
+  size_t pristine;                  // uordblks of the empty mspace
+  unsigned count;
+  eRegion_t region[EREGION_MAX];    // sorted by offset
+} eRegions_t;
+
+
+inline static int eRegionOverlap(uint32_t aOff, uint32_t aSize, uint32_t bOff, uint32_t bSize)
+{
+  return (uint64_t)aOff < (uint64_t)bOff + bSize && (uint64_t)bOff < (uint64_t)aOff + aSize;
+}
+
+// largest granularity aligned gap between the reservations below the region
+// area, the heap never moves into it
+static void eRegionGap(eRegions_t *r, uint32_t *gapOff, uint32_t *gapSize)
+{
+  uint64_t end = r->areaOff, cur = r->arenaOff;
+  *gapOff = *gapSize = 0;
+  for(unsigned i = 0; i <= r->count; ++i) {
+    uint64_t nxt = i < r->count && r->region[i].offset < end ? r->region[i].offset : end;
+    uint64_t bgn = (cur + EREGION_PAGE - 1) & ~(uint64_t)(EREGION_PAGE - 1);
+    uint64_t fin = nxt & ~(uint64_t)(EREGION_PAGE - 1);
+    if(fin > bgn && fin - bgn > *gapSize) {
+      *gapOff = (uint32_t)bgn;
+      *gapSize = (uint32_t)(fin - bgn);
+    }
+    if(nxt == end)
+      break;
+    cur = (uint64_t)r->region[i].offset + r->region[i].size;
+  }
+}
+
+// heap exclusively locked
+static int eRegionHeapEmpty(eConfigMem_t *emem, eRegions_t *r)
+{
+  // a lost heap (see eRegionMove()) holds nothing
+  if(!emem->space)
+    return 1;
+  // the calling thread's cache must not count as in use
+  eTcacheFlush();
+  return !eSlabTrim(emem)
+         && mspace_mallinfo(emem->space).uordblks == r->pristine;
+}
+
+// heap exclusively locked
+static int eRegionHeap(eConfigMem_t *emem, eRegions_t *r, uint32_t off, uint32_t size)
+{
+  eSlabFini(emem);
+  if(emem->space)
+    destroy_mspace(emem->space);
+
+  emem->space = create_mspace_with_base(emem->epi_base + off, size, 1);
+  if(emem->space) {
+    if(mspace_set_footprint_limit(emem->space, size) == size
+       && !eSlabInit(emem)) {
+      r->heapOff = off;
+      r->heapSize = size;
+      r->pristine = mspace_mallinfo(emem->space).uordblks;
+      eCoresPrintf(E_DBG, "eMem heap now spans 0x%08x - 0x%08x\n",
+                   eMemHostToEpi(emem, emem->epi_base + off),
+                   eMemHostToEpi(emem, emem->epi_base + off + size));
+      return 0;
+    }
+    destroy_mspace(emem->space);
+    emem->space = NULL;
+  }
+  eCoresError("Could not rebuild eMem heap at offset 0x%x (%s)!\n", off, fmtBytes(size));
+  return -1;
+}
+
+// heap exclusively locked, rebuilds it at the new span resp. on failure
+// at the old one again. If even that fails the heap is lost: space and slab
+// stay NULL and eMemAlloc() fails until a release lets it come back
+static int eRegionMove(eConfigMem_t *emem, eRegions_t *r, uint32_t off, uint32_t size)
+{
+  uint32_t heapOff = r->heapOff, heapSize = r->heapSize;
+  if(!eRegionHeap(emem, r, off, size))
+    return 0;
+  if(!heapSize || eRegionHeap(emem, r, heapOff, heapSize)) {
+    r->heapOff = r->heapSize = 0;
+    eCoresError("eMem heap is lost, allocations fail until a reservation gets released!\n");
+  }
+  return -1;
+}
+
+uint32_t eRegionAreaSize(uint32_t arenaSize)
+{
+  if(arenaSize < 2 * EREGION_MIN_HEAP)
+    return 0;
+  const char *env = getenv("EHAL_EMEM_REGIONS");
+  uint64_t size = env ? strtoull(env, NULL, 0)
+                : EREGION_AREA < arenaSize / 2 ? EREGION_AREA : arenaSize / 2;
+  if(size > arenaSize - EREGION_MIN_HEAP) {
+    eCoresWarn("EHAL_EMEM_REGIONS %s leaves no heap, capped\n", env);
+    size = arenaSize - EREGION_MIN_HEAP;
+  }
+  // the heap below ends on a slab boundary
+  return (uint32_t)(arenaSize - ((arenaSize - size) & ~(uint64_t)(EREGION_PAGE - 1)));
+}
+
+int eRegionInit(eConfigMem_t *emem, char *arenaBase, uint32_t arenaSize, uint32_t heapSize)
+{
+  assert( emem );
+  assert( emem->space );
+  assert( heapSize <= arenaSize );
+
+  eRegions_t *r = calloc(1, sizeof(*r));
+  if(r) {
+    if(!pthread_mutex_init(&r->lock, NULL)) {
+      if(!pthread_rwlock_init(&r->heap, NULL)) {
+        r->arenaOff = r->heapOff = (uint32_t)(arenaBase - emem->epi_base);
+        r->arenaSize = arenaSize;
+        r->heapSize = heapSize;
+        r->areaOff = r->arenaOff + heapSize;
+        if(heapSize < arenaSize)
+          eCoresPrintf(E_DBG, "eMem region area spans 0x%08x - 0x%08x\n",
+                       eMemHostToEpi(emem, emem->epi_base + r->areaOff),
+                       eMemHostToEpi(emem, arenaBase + arenaSize));
+        r->pristine = mspace_mallinfo(emem->space).uordblks;
+        emem->regions = r;
+        return 0;
+      }
+      pthread_mutex_destroy(&r->lock);
+    }
+    free(r);
+  }
+  eCoresError("Could not set up eMem region reservations!\n");
+  return -1;
+}
+
+void eRegionFini(eConfigMem_t *emem)
+{
+  assert( emem );
+
+  eRegions_t *r = emem->regions;
+  if(!r)
+    return;
+  pthread_rwlock_destroy(&r->heap);
+  pthread_mutex_destroy(&r->lock);
+  free(r);
+  emem->regions = NULL;
+}
+
+void eRegionHeapLock(eConfigMem_t *emem)
+{
+  if(emem->regions)
+    pthread_rwlock_rdlock(&emem->regions->heap);
+}
+
+void eRegionHeapUnlock(eConfigMem_t *emem)
+{
+  if(emem->regions)
+    pthread_rwlock_unlock(&emem->regions->heap);
+}
+
+void* eRegionReserve(eConfigMem_t *emem, uint32_t offset, uint32_t size)
+{
+  assert( emem );
+  assert( emem->regions );
+
+  eRegions_t *r = emem->regions;
+  if(!size
+     || offset < r->arenaOff
+     || (uint64_t)offset + size > (uint64_t)r->arenaOff + r->arenaSize) {
+    eCoresError("eMem reservation 0x%x (%s) is out of range!\n", offset, fmtBytes(size));
+    return NULL;
+  }
+
+  // no eMemAlloc() resp. eMemFree() in flight from here on
+  pthread_rwlock_wrlock(&r->heap);
+  pthread_mutex_lock(&r->lock);
+  unsigned i;
+  for(i = 0; i < r->count && r->region[i].offset < offset; ++i);
+  if(r->count == EREGION_MAX
+     || (i > 0 && eRegionOverlap(offset, size, r->region[i-1].offset, r->region[i-1].size))
+     || (i < r->count && eRegionOverlap(offset, size, r->region[i].offset, r->region[i].size))) {
+    pthread_mutex_unlock(&r->lock);
+    pthread_rwlock_unlock(&r->heap);
+    eCoresError("eMem reservation 0x%x (%s) overlaps another one!\n", offset, fmtBytes(size));
+    return NULL;
+  }
+
+  memmove(&r->region[i+1], &r->region[i], (r->count - i) * sizeof(r->region[0]));
+  r->region[i] = (eRegion_t){ .offset = offset, .size = size };
+  ++r->count;
+
+  if(eRegionOverlap(offset, size, r->heapOff, r->heapSize)) {
+    uint32_t gapOff, gapSize;
+    eRegionGap(r, &gapOff, &gapSize);
+    if(!eRegionHeapEmpty(emem, r) || gapSize < EREGION_MIN_HEAP) {
+      --r->count;
+      memmove(&r->region[i], &r->region[i+1], (r->count - i) * sizeof(r->region[0]));
+      pthread_mutex_unlock(&r->lock);
+      pthread_rwlock_unlock(&r->heap);
+      eCoresError("eMem reservation 0x%x (%s) is in use by the heap!\n", offset, fmtBytes(size));
+      return NULL;
+    }
+    if(eRegionMove(emem, r, gapOff, gapSize)) {
+      --r->count;
+      memmove(&r->region[i], &r->region[i+1], (r->count - i) * sizeof(r->region[0]));
+      pthread_mutex_unlock(&r->lock);
+      pthread_rwlock_unlock(&r->heap);
+      return NULL;
+    }
+  }
+  pthread_mutex_unlock(&r->lock);
+  pthread_rwlock_unlock(&r->heap);
+
+  eCoresPrintf(E_DBG, "eMem reserved 0x%x (%s)\n", offset, fmtBytes(size));
+  return emem->epi_base + offset;
+}
+
+int eRegionRelease(eConfigMem_t *emem, uint32_t offset)
+{
+  assert( emem );
+  assert( emem->regions );
+
+  eRegions_t *r = emem->regions;
+  pthread_rwlock_wrlock(&r->heap);
+  pthread_mutex_lock(&r->lock);
+  unsigned i;
+  for(i = 0; i < r->count && r->region[i].offset != offset; ++i);
+  if(i == r->count) {
+    pthread_mutex_unlock(&r->lock);
+    pthread_rwlock_unlock(&r->heap);
+    eCoresError("eMem offset 0x%x is not reserved!\n", offset);
+    return -1;
+  }
+  --r->count;
+  memmove(&r->region[i], &r->region[i+1], (r->count - i) * sizeof(r->region[0]));
+
+  // grow the heap once it is idle
+  int ret = 0;
+  uint32_t gapOff, gapSize;
+  eRegionGap(r, &gapOff, &gapSize);
+  if(gapSize > r->heapSize && eRegionHeapEmpty(emem, r))
+    ret = eRegionMove(emem, r, gapOff, gapSize);
+  pthread_mutex_unlock(&r->lock);
+  pthread_rwlock_unlock(&r->heap);
+  return ret;
+}
+
+void eRegionStats(eConfigMem_t *emem, eMemStats_t *stats)
+{
+  assert( emem );
+  assert( emem->regions );
+  assert( stats );
+
+  eRegions_t *r = emem->regions;
+  pthread_mutex_lock(&r->lock);
+  stats->heapSize = r->heapSize;
+  stats->regionBytes = r->arenaOff + r->arenaSize - r->areaOff;
+  stats->reservedBytes = 0;
+  for(unsigned i = 0; i < r->count; ++i)
+    stats->reservedBytes += r->region[i].size;
+  pthread_mutex_unlock(&r->lock);
+}
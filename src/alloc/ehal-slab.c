@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "alloc/ehal-slab.h"
+#include "alloc/ehal-stats.h"
+#include "ehal-print.h"
+
+typedef struct eSlab_s {
+  struct eSlab_s *prev, *next;      // partial list of its class
+  char *base;                       // ESLAB_SIZE aligned within eMem
+  uint16_t cls;
+  uint16_t nblocks;
+  uint16_t nfree;                   // top of stack
+  uint16_t stack[];                 // indices of free blocks
+} eSlab_t;
+
+typedef struct eSlabHeap_s {
+  pthread_mutex_t lock;
+  eSlab_t *partial[ESLAB_CLASSES];  // slabs with at least one free block
+  eSlab_t **slabs;                  // indexed by (ptr - epi_base) >> ESLAB_SHIFT
+  uint8_t *cls;                     // same index, class + 1 resp. 0 for none,
+                                    // read without lock (eSlabUsableSize())
+  uint32_t nslabs;
+
+  // accounting, solely updated under lock
+  size_t live, peak;                // bytes handed out
+  unsigned used;                    // slabs
+  uint64_t allocs, frees;
+} eSlabHeap_t;
+
+
+inline static void eSlabLink(eSlabHeap_t *heap, eSlab_t *slab)
+{
+  slab->prev = NULL;
+  slab->next = heap->partial[slab->cls];
+  if(slab->next)
+    slab->next->prev = slab;
+  heap->partial[slab->cls] = slab;
+}
+
+inline static void eSlabUnlink(eSlabHeap_t *heap, eSlab_t *slab)
+{
+  if(slab->prev)
+    slab->prev->next = slab->next;
+  else
+    heap->partial[slab->cls] = slab->next;
+  if(slab->next)
+    slab->next->prev = slab->prev;
+  slab->prev = slab->next = NULL;
+}
+
+static eSlab_t* eSlabNew(eConfigMem_t *emem, unsigned cls)
+{
+  eSlabHeap_t *heap = emem->slab;
+  uint16_t nblocks = (uint16_t)(ESLAB_SIZE / eSlabClassSize(cls));
+  eSlab_t *slab = malloc(sizeof(*slab) + nblocks * sizeof(slab->stack[0]));
+  if(!slab)
+    return NULL;
+
+  slab->base = mspace_memalign(emem->space, ESLAB_SIZE, ESLAB_SIZE);
+  if(!slab->base) {
+    free(slab);
+    return NULL;
+  }
+  slab->cls = cls;
+  slab->nblocks = nblocks;
+  slab->nfree = nblocks;
+  // pop ascending, consecutive allocations are consecutive in eMem
+  for(uint16_t i = 0; i < nblocks; ++i)
+    slab->stack[i] = nblocks - 1 - i;
+
+  uint32_t idx = (slab->base - emem->epi_base) >> ESLAB_SHIFT;
+  heap->slabs[idx] = slab;
+  __atomic_store_n(&heap->cls[idx], (uint8_t)(cls + 1), __ATOMIC_RELEASE);
+  ++heap->used;
+  eSlabLink(heap, slab);
+  return slab;
+}
+
+static void eSlabDelete(eConfigMem_t *emem, eSlab_t *slab)
+{
+  eSlabHeap_t *heap = emem->slab;
+  eSlabUnlink(heap, slab);
+  uint32_t idx = (slab->base - emem->epi_base) >> ESLAB_SHIFT;
+  heap->slabs[idx] = NULL;
+  __atomic_store_n(&heap->cls[idx], 0, __ATOMIC_RELEASE);
+  --heap->used;
+  mspace_free(emem->space, slab->base);
+  free(slab);
+}
+
+inline static eSlab_t* eSlabOf(eConfigMem_t *emem, const void *host)
+{
+  eSlabHeap_t *heap = emem->slab;
+  uintptr_t off = (uintptr_t)((const char*)host - emem->epi_base);
+  assert( off < emem->size );
+  return heap->slabs[off >> ESLAB_SHIFT];
+}
+
+int eSlabInit(eConfigMem_t *emem)
+{
+  assert( emem );
+  assert( emem->space );
+
+  eSlabHeap_t *heap = calloc(1, sizeof(*heap));
+  if(heap) {
+    heap->nslabs = (emem->size + ESLAB_SIZE - 1) >> ESLAB_SHIFT;
+    heap->slabs = calloc(heap->nslabs, sizeof(heap->slabs[0]));
+    heap->cls = calloc(heap->nslabs, sizeof(heap->cls[0]));
+    if(heap->slabs && heap->cls) {
+      if(!pthread_mutex_init(&heap->lock, NULL)) {
+        emem->slab = heap;
+        return 0;
+      }
+    }
+    free(heap->cls);
+    free(heap->slabs);
+    free(heap);
+  }
+  eCoresError("Could not set up eMem slab allocator!\n");
+  return -1;
+}
+
+void eSlabFini(eConfigMem_t *emem)
+{
+  assert( emem );
+
+  eSlabHeap_t *heap = emem->slab;
+  if(!heap)
+    return;
+
+  // the slabs' eMem goes along with the mspace
+  for(uint32_t i = 0; i < heap->nslabs; ++i)
+    free(heap->slabs[i]);
+  free(heap->cls);
+  free(heap->slabs);
+  pthread_mutex_destroy(&heap->lock);
+  free(heap);
+  emem->slab = NULL;
+}
+
+// heap->lock held
+inline static void eSlabLive(eSlabHeap_t *heap, size_t bytes)
+{
+  heap->live += bytes;
+  if(heap->live > heap->peak)
+    heap->peak = heap->live;
+}
+
+// heap->lock held
+static void* eSlabPop(eConfigMem_t *emem, unsigned cls)
+{
+  eSlabHeap_t *heap = emem->slab;
+  eSlab_t *slab = heap->partial[cls];
+  if(!slab && !(slab = eSlabNew(emem, cls)))
+    return NULL;
+
+  uint16_t idx = slab->stack[--slab->nfree];
+  if(!slab->nfree)
+    eSlabUnlink(heap, slab);
+  eSlabLive(heap, eSlabClassSize(cls));
+  return slab->base + idx * eSlabClassSize(cls);
+}
+
+// heap->lock held
+static void eSlabPush(eConfigMem_t *emem, eSlab_t *slab, void *host)
+{
+  size_t bytes = eSlabClassSize(slab->cls);
+  uintptr_t off = (uintptr_t)((char*)host - slab->base);
+  assert( !(off & (bytes - 1)) );
+  slab->stack[slab->nfree++] = (uint16_t)(off / bytes);
+  emem->slab->live -= bytes;
+
+  if(slab->nfree == 1)
+    eSlabLink(emem->slab, slab);
+  // keep a single empty slab per class to avoid thrashing the mspace
+  if(slab->nfree == slab->nblocks && (slab->prev || slab->next))
+    eSlabDelete(emem, slab);
+}
+
+eMemPtr_t eSlabAlloc(eConfigMem_t *emem, size_t size)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  eSlabHeap_t *heap = emem->slab;
+  eMemPtr_t p = { NULL, 0 };
+  if(size > ESLAB_MAX) {
+    p.host = mspace_memalign(emem->space, ESLAB_LARGE_ALIGN, size);
+    pthread_mutex_lock(&heap->lock);
+    if(p.host)
+      eSlabLive(heap, mspace_usable_size(p.host));
+    ++heap->allocs;
+    pthread_mutex_unlock(&heap->lock);
+  }
+  else {
+    pthread_mutex_lock(&heap->lock);
+    p.host = eSlabPop(emem, eSlabClass(size));
+    ++heap->allocs;
+    pthread_mutex_unlock(&heap->lock);
+  }
+
+  if(p.host)
+    p.eaddr = eMemHostToEpi(emem, p.host);
+  return p;
+}
+
+void eSlabFree(eConfigMem_t *emem, void *host)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  if(!host)
+    return;
+
+  eSlabHeap_t *heap = emem->slab;
+  pthread_mutex_lock(&heap->lock);
+  eSlab_t *slab = eSlabOf(emem, host);
+  if(slab)
+    eSlabPush(emem, slab, host);
+  else
+    heap->live -= mspace_usable_size(host);
+  ++heap->frees;
+  pthread_mutex_unlock(&heap->lock);
+
+  if(!slab)
+    mspace_free(emem->space, host);
+}
+
+unsigned eSlabAllocBatch(eConfigMem_t *emem, unsigned cls, void **blocks, unsigned n)
+{
+  assert( emem );
+  assert( emem->slab );
+  assert( cls < ESLAB_CLASSES );
+
+  eSlabHeap_t *heap = emem->slab;
+  unsigned i;
+  pthread_mutex_lock(&heap->lock);
+  for(i = 0; i < n && (blocks[i] = eSlabPop(emem, cls)); ++i);
+  pthread_mutex_unlock(&heap->lock);
+  return i;
+}
+
+void eSlabFreeBatch(eConfigMem_t *emem, void **blocks, unsigned n)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  eSlabHeap_t *heap = emem->slab;
+  pthread_mutex_lock(&heap->lock);
+  for(unsigned i = 0; i < n; ++i) {
+    eSlab_t *slab = eSlabOf(emem, blocks[i]);
+    assert( slab );
+    eSlabPush(emem, slab, blocks[i]);
+  }
+  pthread_mutex_unlock(&heap->lock);
+}
+
+unsigned eSlabTrim(eConfigMem_t *emem)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  eSlabHeap_t *heap = emem->slab;
+  unsigned used = 0;
+  pthread_mutex_lock(&heap->lock);
+  for(uint32_t i = 0; i < heap->nslabs; ++i) {
+    eSlab_t *slab = heap->slabs[i];
+    if(slab && slab->nfree == slab->nblocks)
+      eSlabDelete(emem, slab);
+    else if(slab)
+      ++used;
+  }
+  pthread_mutex_unlock(&heap->lock);
+  return used;
+}
+
+void eSlabCount(eConfigMem_t *emem, uint64_t allocs, uint64_t frees)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  eSlabHeap_t *heap = emem->slab;
+  pthread_mutex_lock(&heap->lock);
+  heap->allocs += allocs;
+  heap->frees += frees;
+  pthread_mutex_unlock(&heap->lock);
+}
+
+void eSlabStats(eConfigMem_t *emem, eMemStats_t *stats)
+{
+  assert( emem );
+  assert( emem->slab );
+  assert( stats );
+
+  eSlabHeap_t *heap = emem->slab;
+  pthread_mutex_lock(&heap->lock);
+  stats->liveBytes = heap->live;
+  stats->peakBytes = heap->peak;
+  stats->allocs = heap->allocs;
+  stats->frees = heap->frees;
+  stats->slabs = heap->used;
+  stats->slabBytes = (size_t)heap->used * ESLAB_SIZE;
+  stats->slabFreeBytes = 0;
+  for(unsigned cls = 0; cls < ESLAB_CLASSES; ++cls)
+    for(eSlab_t *slab = heap->partial[cls]; slab; slab = slab->next)
+      stats->slabFreeBytes += slab->nfree * eSlabClassSize(cls);
+  pthread_mutex_unlock(&heap->lock);
+}
+
+size_t eSlabUsableSize(eConfigMem_t *emem, const void *host)
+{
+  assert( emem );
+  assert( emem->slab );
+
+  // the slab itself might get deleted meanwhile by another thread (a block
+  // owned by the caller keeps its slab alive, any other pointer does not),
+  // hence solely the class table, which never points anywhere
+  eSlabHeap_t *heap = emem->slab;
+  uintptr_t off = (uintptr_t)((const char*)host - emem->epi_base);
+  assert( off < emem->size );
+  uint8_t cls = __atomic_load_n(&heap->cls[off >> ESLAB_SHIFT], __ATOMIC_ACQUIRE);
+  return cls ? eSlabClassSize(cls - 1) : 0;
+}
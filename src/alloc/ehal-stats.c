@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include "alloc/ehal-region.h"
+#include "alloc/ehal-slab.h"
+#include "alloc/ehal-stats.h"
+#include "alloc/ehal-tcache.h"
+#include "ehal-print.h"
+
+eMemTrace_t *etrace = NULL;
+static eMemTrace_t *etraceBuf = NULL;   // kept until fini, records might be in flight
+static unsigned etraceMask;
+static unsigned long etraceHead;
+
+
+static void eStatsFree(void *start, void *end, size_t used, void *arg)
+{
+  size_t *largest = arg;
+  if(!used && (size_t)((char*)end - (char*)start) > *largest)
+    *largest = (char*)end - (char*)start;
+}
+
+int eStatsGet(eConfigMem_t *emem, eMemStats_t *stats)
+{
+  assert( emem );
+  assert( stats );
+
+  if(!emem->regions)
+    return -1;
+  eRegionHeapLock(emem);
+  if(!emem->space || !emem->slab) {
+    eRegionHeapUnlock(emem);
+    return -1;
+  }
+
+  eTcacheCount(emem);
+  eSlabStats(emem, stats);
+  eRegionStats(emem, stats);
+  // the slab counts blocks within the thread caches as handed out
+  stats->cachedBytes = eTcacheCached(emem);
+  if(stats->cachedBytes > stats->liveBytes)
+    stats->cachedBytes = stats->liveBytes;
+  stats->liveBytes -= stats->cachedBytes;
+
+  struct mallinfo mi = mspace_mallinfo(emem->space);
+  stats->mspaceUsed = mi.uordblks;
+  stats->mspaceFree = mi.fordblks;
+
+  // walks all chunks under the mspace lock, not meant for hot paths
+  stats->largestFree = 0;
+  mspace_inspect_all(emem->space, eStatsFree, &stats->largestFree);
+  stats->fragmentation = stats->mspaceFree
+                         ? 1.0 - (double)stats->largestFree / stats->mspaceFree
+                         : 0.0;
+  eRegionHeapUnlock(emem);
+  return 0;
+}
+
+void eStatsPrint(FILE *out, const eMemStats_t *stats)
+{
+  assert( out );
+  assert( stats );
+
+  fprintf(out, "[xx,xx] eMem heap:\n");
+  fprintf(out, "[xx,xx] ├ HEAP               %s\n", fmtBytes(stats->heapSize));
+  fprintf(out, "[xx,xx] ├ REGION AREA        %s\n", fmtBytes(stats->regionBytes));
+  fprintf(out, "[xx,xx] ├ RESERVED           %s\n", fmtBytes(stats->reservedBytes));
+  fprintf(out, "[xx,xx] ├ LIVE               %s\n", fmtBytes(stats->liveBytes));
+  fprintf(out, "[xx,xx] ├ CACHED             %s\n", fmtBytes(stats->cachedBytes));
+  fprintf(out, "[xx,xx] ├ PEAK               %s\n", fmtBytes(stats->peakBytes));
+  fprintf(out, "[xx,xx] ├ SLABS              %u (%s", stats->slabs, fmtBytes(stats->slabBytes));
+  fprintf(out, ", %s free)\n", fmtBytes(stats->slabFreeBytes));
+  fprintf(out, "[xx,xx] ├ MSPACE_USED        %s\n", fmtBytes(stats->mspaceUsed));
+  fprintf(out, "[xx,xx] ├ MSPACE_FREE        %s\n", fmtBytes(stats->mspaceFree));
+  fprintf(out, "[xx,xx] ├ LARGEST_FREE       %s\n", fmtBytes(stats->largestFree));
+  fprintf(out, "[xx,xx] ├ FRAGMENTATION      %.1f %%\n", stats->fragmentation * 100.0);
+  fprintf(out, "[xx,xx] └ ALLOCS/FREES       %llu/%llu\n",
+          (unsigned long long)stats->allocs, (unsigned long long)stats->frees);
+}
+
+int eStatsTraceStart(unsigned entries)
+{
+  // the ring is allocated once, later starts reuse it
+  if(etraceBuf && entries != etraceMask + 1) {
+    eCoresError("eMem trace keeps its %u entries, %u requested!\n", etraceMask + 1, entries);
+    return -1;
+  }
+  if(!etraceBuf) {
+    if(!entries || (entries & (entries - 1))) {
+      eCoresError("eMem trace entries must be a power of 2!\n");
+      return -1;
+    }
+    if(!(etraceBuf = calloc(entries, sizeof(*etraceBuf)))) {
+      eCoresError("Could not allocate eMem trace of %u entries!\n", entries);
+      return -1;
+    }
+    etraceMask = entries - 1;
+  }
+  __atomic_store_n(&etraceHead, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&etrace, etraceBuf, __ATOMIC_RELEASE);
+  return 0;
+}
+
+void eStatsTraceStop(void)
+{
+  __atomic_store_n(&etrace, NULL, __ATOMIC_RELEASE);
+}
+
+void eStatsTraceRecord(uint32_t eaddr, int32_t size)
+{
+  eMemTrace_t *ring = __atomic_load_n(&etrace, __ATOMIC_ACQUIRE);
+  if(!ring)
+    return;
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  unsigned long idx = __atomic_fetch_add(&etraceHead, 1, __ATOMIC_RELAXED);
+  eMemTrace_t *rec = &ring[idx & etraceMask];
+  rec->ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  rec->eaddr = eaddr;
+  rec->size = size;
+}
+
+size_t eStatsTraceRead(eMemTrace_t *out, size_t n)
+{
+  assert( out || !n );
+
+  if(!etraceBuf)
+    return 0;
+
+  // oldest first
+  unsigned long head = __atomic_load_n(&etraceHead, __ATOMIC_ACQUIRE);
+  size_t avail = head < etraceMask + 1ul ? head : etraceMask + 1ul;
+  if(n > avail)
+    n = avail;
+  for(size_t i = 0; i < n; ++i)
+    out[i] = etraceBuf[(head - n + i) & etraceMask];
+  return n;
+}
+
+void eStatsTraceFini(void)
+{
+  eStatsTraceStop();
+  free(etraceBuf);
+  etraceBuf = NULL;
+}
@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc/ehal-region.h"
+#include "alloc/ehal-tcache.h"
+
+typedef struct {
+  unsigned count;
+  void *blocks[ETCACHE_DEPTH];      // LIFO, blocks[count-1] is the hottest
+} eTcacheBin_t;
+
+typedef struct eTcache_s {
+  struct eTcache_s *prev, *next;    // all caches, for eTcacheCached()
+  eConfigMem_t *emem;               // heap the bins belong to
+  size_t cached;                    // bytes within the bins
+  unsigned ops;
+  uint64_t allocs, frees;           // not yet reported to the slab
+  eTcacheBin_t bins[ESLAB_CLASSES];
+} eTcache_t;
+
+// initial-exec avoids a __tls_get_addr() call per alloc/free, solely a
+// pointer to stay within the static TLS surplus in case of dlopen()
+static __thread eTcache_t *etcache __attribute__((tls_model("initial-exec")));
+static pthread_key_t etcacheKey;
+static pthread_once_t etcacheOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t etcacheLock = PTHREAD_MUTEX_INITIALIZER;
+static eTcache_t *etcaches = NULL;
+
+
+// solely the owning thread writes, eTcacheCached() reads from any other one
+inline static void eTcacheCache(eTcache_t *tc, ptrdiff_t bytes)
+{
+  __atomic_store_n(&tc->cached, tc->cached + bytes, __ATOMIC_RELAXED);
+}
+
+inline static void eTcacheBind(eTcache_t *tc, eConfigMem_t *emem)
+{
+  __atomic_store_n(&tc->emem, emem, __ATOMIC_RELAXED);
+}
+
+inline static unsigned eTcacheCapacity(unsigned cls)
+{
+  size_t n = ETCACHE_BIN_BYTES / eSlabClassSize(cls);
+  return n < 2 ? 2 : n > ETCACHE_DEPTH ? ETCACHE_DEPTH : (unsigned)n;
+}
+
+// hand the n oldest blocks of a bin back to the central slab
+static void eTcacheReturn(eTcache_t *tc, eTcacheBin_t *bin, unsigned n)
+{
+  if(!n)
+    return;
+  eSlabFreeBatch(tc->emem, bin->blocks, n);
+  eTcacheCache(tc, -(ptrdiff_t)(n * eSlabClassSize(bin - tc->bins)));
+  bin->count -= n;
+  memmove(&bin->blocks[0], &bin->blocks[n], bin->count * sizeof(bin->blocks[0]));
+}
+
+static void eTcacheReport(eTcache_t *tc)
+{
+  eSlabCount(tc->emem, tc->allocs, tc->frees);
+  tc->allocs = tc->frees = 0;
+}
+
+static void eTcacheDrain(eTcache_t *tc)
+{
+  // the heap might be gone already (libehal fini before thread exit)
+  if(!tc->emem || !tc->emem->slab) {
+    memset(tc->bins, 0, sizeof(tc->bins));
+    tc->ops = 0;
+    tc->allocs = tc->frees = 0;
+    eTcacheCache(tc, -(ptrdiff_t)tc->cached);
+    eTcacheBind(tc, NULL);
+    return;
+  }
+  for(unsigned cls = 0; cls < ESLAB_CLASSES; ++cls)
+    eTcacheReturn(tc, &tc->bins[cls], tc->bins[cls].count);
+  eTcacheReport(tc);
+  eTcacheBind(tc, NULL);
+}
+
+static void eTcacheScavenge(eTcache_t *tc)
+{
+  eTcacheReport(tc);
+  for(unsigned cls = 0; cls < ESLAB_CLASSES; ++cls) {
+    unsigned keep = eTcacheCapacity(cls) / 2;
+    eTcacheBin_t *bin = &tc->bins[cls];
+    if(bin->count > keep)
+      eTcacheReturn(tc, bin, bin->count - keep);
+  }
+}
+
+// Accesses of the central heap exclude a rebuild (alloc/ehal-region.h).
+// The bins themselves need not: their blocks count as live to the slab,
+// which keeps any rebuild off as long as a single one is cached.
+static void eTcacheDrainShared(eTcache_t *tc)
+{
+  eConfigMem_t *emem = tc->emem;
+  if(emem)
+    eRegionHeapLock(emem);
+  eTcacheDrain(tc);
+  if(emem)
+    eRegionHeapUnlock(emem);
+}
+
+static eMemPtr_t eTcacheCentralAlloc(eConfigMem_t *emem, size_t size)
+{
+  eMemPtr_t p = { NULL, 0 };
+  eRegionHeapLock(emem);
+  if(emem->slab) // else lost by a failed rebuild
+    p = eSlabAlloc(emem, size);
+  eRegionHeapUnlock(emem);
+  return p;
+}
+
+static void eTcacheCentralFree(eConfigMem_t *emem, void *host)
+{
+  eRegionHeapLock(emem);
+  if(emem->slab)
+    eSlabFree(emem, host);
+  eRegionHeapUnlock(emem);
+}
+
+static void eTcacheExit(void *arg)
+{
+  eTcache_t *tc = arg;
+  eTcacheDrainShared(tc);
+
+  pthread_mutex_lock(&etcacheLock);
+  if(tc->prev)
+    tc->prev->next = tc->next;
+  else
+    etcaches = tc->next;
+  if(tc->next)
+    tc->next->prev = tc->prev;
+  pthread_mutex_unlock(&etcacheLock);
+  free(tc);
+  etcache = NULL;
+}
+
+static void eTcacheKey(void)
+{
+  pthread_key_create(&etcacheKey, eTcacheExit);
+}
+
+static eTcache_t* eTcacheNew(void)
+{
+  eTcache_t *tc = calloc(1, sizeof(*tc));
+  if(tc) {
+    // solely for the destructor on thread exit
+    pthread_once(&etcacheOnce, eTcacheKey);
+    if(pthread_setspecific(etcacheKey, tc)) {
+      free(tc);
+      return NULL;
+    }
+    pthread_mutex_lock(&etcacheLock);
+    tc->next = etcaches;
+    if(etcaches)
+      etcaches->prev = tc;
+    etcaches = tc;
+    pthread_mutex_unlock(&etcacheLock);
+    etcache = tc;
+  }
+  return tc;
+}
+
+inline static eTcache_t* eTcacheGet(eConfigMem_t *emem)
+{
+  eTcache_t *tc = etcache;
+  if(__builtin_expect(!tc, 0) && !(tc = eTcacheNew()))
+    return NULL;
+  if(__builtin_expect(tc->emem != emem, 0)) {
+    eTcacheDrainShared(tc);
+    eTcacheBind(tc, emem);
+  }
+  if(__builtin_expect(++tc->ops >= ETCACHE_SCAVENGE, 0)) {
+    tc->ops = 0;
+    eRegionHeapLock(emem);
+    if(emem->slab)
+      eTcacheScavenge(tc);
+    eRegionHeapUnlock(emem);
+  }
+  return tc;
+}
+
+eMemPtr_t eTcacheAlloc(eConfigMem_t *emem, size_t size)
+{
+  assert( emem );
+
+  if(size > ESLAB_MAX)
+    return eTcacheCentralAlloc(emem, size);
+
+  eTcache_t *tc = eTcacheGet(emem);
+  if(__builtin_expect(!tc, 0))
+    return eTcacheCentralAlloc(emem, size);
+
+  unsigned cls = eSlabClass(size);
+  eTcacheBin_t *bin = &tc->bins[cls];
+  if(!bin->count) {
+    // central hands out ascending blocks, keep that order for the pops
+    void *refill[ETCACHE_DEPTH];
+    unsigned n = 0;
+    eRegionHeapLock(emem);
+    if(emem->slab)
+      n = eSlabAllocBatch(emem, cls, refill, eTcacheCapacity(cls) / 2);
+    eRegionHeapUnlock(emem);
+    for(unsigned i = 0; i < n; ++i)
+      bin->blocks[i] = refill[n - 1 - i];
+    bin->count = n;
+    eTcacheCache(tc, (ptrdiff_t)(n * eSlabClassSize(cls)));
+  }
+
+  eMemPtr_t p = { NULL, 0 };
+  ++tc->allocs;
+  if(bin->count) {
+    eTcacheCache(tc, -(ptrdiff_t)eSlabClassSize(cls));
+    p.host = bin->blocks[--bin->count];
+    p.eaddr = eMemHostToEpi(emem, p.host);
+  }
+  return p;
+}
+
+void eTcacheFree(eConfigMem_t *emem, void *host)
+{
+  assert( emem );
+
+  if(!host)
+    return;
+
+  size_t bytes = eSlabUsableSize(emem, host);
+  if(!bytes) {
+    eTcacheCentralFree(emem, host);
+    return;
+  }
+
+  eTcache_t *tc = eTcacheGet(emem);
+  if(__builtin_expect(!tc, 0)) {
+    eTcacheCentralFree(emem, host);
+    return;
+  }
+
+  unsigned cls = eSlabClass(bytes);
+  eTcacheBin_t *bin = &tc->bins[cls];
+  ++tc->frees;
+  if(bin->count == eTcacheCapacity(cls)) {
+    eRegionHeapLock(emem);
+    eTcacheReturn(tc, bin, bin->count / 2);
+    eRegionHeapUnlock(emem);
+  }
+  bin->blocks[bin->count++] = host;
+  eTcacheCache(tc, (ptrdiff_t)bytes);
+}
+
+void eTcacheFlush(void)
+{
+  if(etcache)
+    eTcacheDrain(etcache);
+}
+
+void eTcacheCount(eConfigMem_t *emem)
+{
+  if(etcache && etcache->emem == emem)
+    eTcacheReport(etcache);
+}
+
+size_t eTcacheCached(eConfigMem_t *emem)
+{
+  size_t bytes = 0;
+  pthread_mutex_lock(&etcacheLock);
+  for(eTcache_t *tc = etcaches; tc; tc = tc->next)
+    if(__atomic_load_n(&tc->emem, __ATOMIC_RELAXED) == emem)
+      bytes += __atomic_load_n(&tc->cached, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&etcacheLock);
+  return bytes;
+}
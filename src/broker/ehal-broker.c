@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* accept4, SOCK_CLOEXEC, MSG_CMSG_CLOEXEC */
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "ehal-print.h"
+#include "broker/ehal-broker.h"
+
+#define EBROKER_MAGIC       0x45424b52 // 'EBKR'
+#define EBROKER_PAGE        0x1000
+
+typedef struct {
+  uint32_t magic;
+  int32_t status;                   // 0 on success, otherwise errno
+  eBrokerLease_t lease;
+  uint32_t type;                    // eChip_t as identified by the broker
+  uint32_t xyDim;
+} eBrokerMsg_t;
+
+typedef struct {
+  int fd;                           // -1 if unused
+  eBrokerLease_t lease;
+} eBrokerClient_t;
+
+
+eBrokerLease_t ebrokerLease;
+static int ebrokerConn = -1;
+static volatile sig_atomic_t ebrokerStop = 0;
+
+
+static int eBrokerRectOverlap(const eBrokerLease_t *a, const eBrokerLease_t *b)
+{
+  return a->row < b->row + b->rows && b->row < a->row + a->rows
+         && a->col < b->col + b->cols && b->col < a->col + a->cols;
+}
+
+// first fit within eMem, leases are kept page aligned
+static int eBrokerEmemFit(eBrokerClient_t *clients, eBrokerClient_t *self,
+                          uint32_t ememSize, eBrokerLease_t *lease)
+{
+  if(!lease->ememSize || lease->ememSize > ememSize)
+    return -1;
+  uint32_t size = (lease->ememSize + EBROKER_PAGE - 1) & ~(EBROKER_PAGE - 1);
+
+  for(uint32_t offset = 0; size <= ememSize - offset; ) {
+    uint32_t next = 0;
+    for(eBrokerClient_t *c = clients; c < &clients[EBROKER_MAX_CLIENTS]; ++c)
+      if(c != self && c->fd != -1
+         && offset < c->lease.ememOffset + c->lease.ememSize
+         && c->lease.ememOffset < offset + size
+         && next < c->lease.ememOffset + c->lease.ememSize)
+        next = c->lease.ememOffset + c->lease.ememSize;
+    if(!next) {
+      lease->ememOffset = offset;
+      lease->ememSize = size;
+      return 0;
+    }
+    offset = next;
+  }
+  return -1;
+}
+
+static int eBrokerGrant(eConfig_t *cfg, eBrokerClient_t *clients, eBrokerClient_t *self,
+                        eBrokerLease_t *lease)
+{
+  unsigned xyDim = cfg->lchip->xyDim;
+  if(!lease->rows || !lease->cols) {
+    lease->row = lease->col = 0;
+    lease->rows = lease->cols = xyDim;
+  }
+  if(lease->rows > xyDim || lease->row > xyDim - lease->rows
+     || lease->cols > xyDim || lease->col > xyDim - lease->cols)
+    return EINVAL;
+
+  for(eBrokerClient_t *c = clients; c < &clients[EBROKER_MAX_CLIENTS]; ++c)
+    if(c != self && c->fd != -1
+       && eBrokerRectOverlap(&c->lease, lease))
+      return EBUSY;
+
+  if(eBrokerEmemFit(clients, self, cfg->lemem->size, lease))
+    return ENOMEM;
+
+  return 0;
+}
+
+static int eBrokerSend(int sock, eBrokerMsg_t *msg, int fd)
+{
+  struct iovec iov = { .iov_base = msg, .iov_len = sizeof(*msg) };
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct msghdr mh = {
+    .msg_iov = &iov,
+    .msg_iovlen = 1,
+  };
+
+  if(fd != -1) {
+    memset(&ctrl, 0, sizeof(ctrl));
+    mh.msg_control = ctrl.buf;
+    mh.msg_controllen = sizeof(ctrl.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  return sendmsg(sock, &mh, MSG_NOSIGNAL) == sizeof(*msg) ? 0 : -1;
+}
+
+static int eBrokerRecv(int sock, eBrokerMsg_t *msg, int *fd)
+{
+  struct iovec iov = { .iov_base = msg, .iov_len = sizeof(*msg) };
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct msghdr mh = {
+    .msg_iov = &iov,
+    .msg_iovlen = 1,
+    .msg_control = ctrl.buf,
+    .msg_controllen = sizeof(ctrl.buf)
+  };
+
+  ssize_t len = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+  if(len != sizeof(*msg) || msg->magic != EBROKER_MAGIC)
+    return -1;
+
+  if(fd) {
+    *fd = -1;
+    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg))
+      if(cmsg->cmsg_level == SOL_SOCKET
+         && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  return 0;
+}
+
+static void eBrokerHandle(eConfig_t *cfg, eBrokerClient_t *clients, eBrokerClient_t *c)
+{
+  eBrokerMsg_t msg;
+  if(eBrokerRecv(c->fd, &msg, NULL)) {
+    eCoresPrintf(E_DBG, "broker: client %d gone, releasing lease\n", c->fd);
+    close(c->fd);
+    c->fd = -1;
+    return;
+  }
+
+  msg.status = eBrokerGrant(cfg, clients, c, &msg.lease);
+  msg.type = cfg->lchip->type;
+  msg.xyDim = cfg->lchip->xyDim;
+  if(!msg.status) {
+    c->lease = msg.lease;
+    eCoresPrintf(E_INF, "broker: client %d leased (%d,%d) %dx%d, eMem [0x%08x:0x%08x]\n",
+                 c->fd, msg.lease.row, msg.lease.col, msg.lease.rows, msg.lease.cols,
+                 msg.lease.ememOffset, msg.lease.ememOffset + msg.lease.ememSize - 1);
+  }
+  else
+    eCoresWarn("broker: client %d lease denied (%s)\n", c->fd, strerror(msg.status));
+
+  if(eBrokerSend(c->fd, &msg, msg.status ? -1 : cfg->fd) || msg.status) {
+    close(c->fd);
+    c->fd = -1;
+  }
+}
+
+// public API
+void eBrokerStop(void)
+{
+  ebrokerStop = 1;
+}
+
+// public API
+int eBrokerServe(eConfig_t *cfg, const char *path)
+{
+  assert( cfg );
+  assert( path );
+
+  if(cfg->fd == -1) {
+    eCoresError("broker: EPIPHANY not bootstrapped\n");
+    return -1;
+  }
+
+  // The fd goes to every client that can open the socket. An fd of /dev/mem
+  // reaches all of the physical memory, not just the EPIPHANY.
+  char fdpath[32], dev[64] = "";
+  snprintf(fdpath, sizeof(fdpath), "/proc/self/fd/%d", cfg->fd);
+  ssize_t devlen = readlink(fdpath, dev, sizeof(dev) - 1);
+  if(devlen > 0)
+    dev[devlen] = '\0';
+  if(devlen <= 0 || !strcmp(dev, "/dev/mem")) {
+    eCoresError("broker: refusing to hand out '%s', needs the epiphany driver\n",
+                devlen > 0 ? dev : fdpath);
+    return -1;
+  }
+
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    eCoresError("broker: socket path too long '%s'\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int lsock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(lsock == -1) {
+    eCoresError("broker: socket failed (errno %d, %s)\n", errno, strerror(errno));
+    return -1;
+  }
+
+  unlink(path);
+  if(bind(lsock, (struct sockaddr*)&addr, sizeof(addr))
+     || chmod(path, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP)
+     || listen(lsock, EBROKER_MAX_CLIENTS)) {
+    eCoresError("broker: could not listen on '%s' (errno %d, %s)\n", path, errno, strerror(errno));
+    close(lsock);
+    return -1;
+  }
+  eCoresPrintf(E_INF, "broker: listening on '%s'\n", path);
+
+  eBrokerClient_t clients[EBROKER_MAX_CLIENTS];
+  for(unsigned i = 0; i < elemsof(clients); ++i)
+    clients[i].fd = -1;
+
+  struct pollfd pfd[EBROKER_MAX_CLIENTS + 1];
+  while(!ebrokerStop) {
+    unsigned n = 0;
+    pfd[n++] = (struct pollfd){ .fd = lsock, .events = POLLIN };
+    for(unsigned i = 0; i < elemsof(clients); ++i)
+      pfd[n++] = (struct pollfd){ .fd = clients[i].fd, .events = POLLIN }; // fd -1 is ignored
+
+    if(poll(pfd, n, 1000) < 0) {
+      if(errno == EINTR)
+        continue;
+      eCoresError("broker: poll failed (errno %d, %s)\n", errno, strerror(errno));
+      break;
+    }
+
+    for(unsigned i = 0; i < elemsof(clients); ++i)
+      if(pfd[i + 1].revents)
+        eBrokerHandle(cfg, clients, &clients[i]);
+
+    if(pfd[0].revents & POLLIN) {
+      int csock = accept4(lsock, NULL, NULL, SOCK_CLOEXEC);
+      if(csock == -1)
+        continue;
+
+      unsigned i;
+      for(i = 0; i < elemsof(clients) && clients[i].fd != -1; ++i);
+      if(i == elemsof(clients)) {
+        eCoresWarn("broker: too many clients\n");
+        close(csock);
+        continue;
+      }
+      clients[i].fd = csock;
+      memset(&clients[i].lease, 0, sizeof(clients[i].lease));
+    }
+  }
+
+  for(unsigned i = 0; i < elemsof(clients); ++i)
+    if(clients[i].fd != -1)
+      close(clients[i].fd);
+  close(lsock);
+  unlink(path);
+
+  return 0;
+}
+
+// public API
+int eBrokerAcquire(const char *path, eBrokerLease_t *lease, eConfigChip_t *chip, int *fd)
+{
+  assert( path );
+  assert( lease );
+  assert( chip );
+  assert( fd );
+
+  eBrokerMsg_t msg = { .magic = EBROKER_MAGIC };
+  char *cores = getenv("EHAL_LEASE_CORES");
+  if(cores
+     && sscanf(cores, "%u,%u,%u,%u", &msg.lease.row, &msg.lease.col,
+                                     &msg.lease.rows, &msg.lease.cols) != 4) {
+    eCoresError("EHAL_LEASE_CORES '%s' not of form row,col,rows,cols\n", cores);
+    return -1;
+  }
+  char *emem = getenv("EHAL_LEASE_EMEM");
+  msg.lease.ememSize = emem ? strtoul(emem, NULL, 0) : EBROKER_DEFAULT_EMEM;
+
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    eCoresError("broker: socket path too long '%s'\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(sock == -1
+     || connect(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+    eCoresError("broker: could not connect to '%s' (errno %d, %s)\n", path, errno, strerror(errno));
+    if(sock != -1)
+      close(sock);
+    return -1;
+  }
+
+  if(eBrokerSend(sock, &msg, -1)
+     || eBrokerRecv(sock, &msg, fd)) {
+    eCoresError("broker: protocol error on '%s'\n", path);
+    close(sock);
+    return -1;
+  }
+  if(msg.status || *fd == -1) {
+    eCoresError("broker: lease denied (%s)\n", strerror(msg.status));
+    close(sock);
+    return -1;
+  }
+
+  *lease = msg.lease;
+  if(chip->type != (eChip_t)msg.type) {
+    chip->type = (eChip_t)msg.type;
+    chip->xyDim = msg.xyDim;
+  }
+  ebrokerConn = sock;
+
+  eCoresPrintf(E_DBG, "broker: leased (%d,%d) %dx%d, eMem [0x%08x:0x%08x]\n",
+               lease->row, lease->col, lease->rows, lease->cols,
+               lease->ememOffset, lease->ememOffset + lease->ememSize - 1);
+  return 0;
+}
+
+// public API
+void eBrokerRelease(void)
+{
+  if(ebrokerConn != -1) {
+    close(ebrokerConn);
+    ebrokerConn = -1;
+  }
+}
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _POSIX_C_SOURCE 200809L /* sigaction */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ehal-print.h"
+#include "broker/ehal-broker.h"
+
+// Bootstrapping is done by libehal upfront main (constructor).
+// Afterwards the daemon solely hands out leases until SIGINT/SIGTERM.
+extern eConfig_t ecfg;
+
+static void stop(int sig)
+{
+  (void)sig;
+  eBrokerStop();
+}
+
+int main(int argc, char *argv[])
+{
+  if(getenv("EHAL_BROKER")) {
+    eCoresError("EHAL_BROKER must not be set for the broker itself! Aborting...\n");
+    return EXIT_FAILURE;
+  }
+
+  const char *path = argc > 1 ? argv[1] : EBROKER_DEFAULT_PATH;
+
+  struct sigaction sa = { .sa_handler = stop };
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  return eBrokerServe(&ecfg, path) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "ehal-async.h"
+#include "ehal-bulk.h"
+#include "ehal-dma.h"
+#include "ehal-mmap.h"
+#include "ehal-print.h"
+
+#define EASYNC_MAX_WORKERS  8
+
+extern eConfig_t ecfg;
+
+typedef enum {
+  EXFER_WRITE = 0,
+  EXFER_READ,
+  EXFER_WRITEV
+} eXferType_t;
+
+struct eXfer_s {
+  struct eXfer_s *next;             // submission queue
+  eXferType_t type;
+  void *dst;
+  const void *src;
+  size_t size;                      // bytes resp. items of EXFER_WRITEV
+  ssize_t result;
+  int submitted;
+  int done;                         // under eAsync.lock
+  int fd;                           // eventfd, -1 until asked for
+};
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t work;              // queue got filled, stop
+  pthread_cond_t done;              // a transfer completed
+  eXfer_t *head, **tail;
+  pthread_t thread[EASYNC_MAX_WORKERS];
+  unsigned workers;
+  int stop;                         // from eAsyncStop() until all workers exited
+} eAsync = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .work = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER,
+  .tail = &eAsync.head
+};
+
+
+static ssize_t eXferRun(eXfer_t *xfer)
+{
+  switch(xfer->type) {
+    case EXFER_WRITE:
+      return eBulkWrite(xfer->dst, xfer->src, xfer->size);
+
+    case EXFER_READ:
+    {
+      // eCore SRAM, have the eCore's DMA help out
+      eConfigChip_t *chip = ecfg.lchip;
+      unsigned row = ECORE_ADDR_ROWID(xfer->src) - ECORE_ADDR_ROWID(chip->eCoreRoot);
+      unsigned col = ECORE_ADDR_COLID(xfer->src) - ECORE_ADDR_COLID(chip->eCoreRoot);
+      if(eCoresAreMapped(&ecfg, row, col, 1, 1)
+         && ECORE_ADDR_LOCAL(xfer->src) < sizeof(chip->eCoreRoot[row][col].sram))
+        return eDmaRead(&ecfg, &chip->eCoreRoot[row][col], ECORE_ADDR_LOCAL(xfer->src),
+                        xfer->dst, xfer->size);
+      return eBulkRead(xfer->dst, xfer->src, xfer->size);
+    }
+
+    case EXFER_WRITEV:
+      return eWritev(&ecfg, xfer->src, xfer->size);
+  }
+  return -1;
+}
+
+static void* eAsyncWorker(void *arg)
+{
+  (void)arg;
+  eXfer_t *batch[EASYNC_BATCH];
+  pthread_mutex_lock(&eAsync.lock);
+  for(;;) {
+    while(!eAsync.head && !eAsync.stop)
+      pthread_cond_wait(&eAsync.work, &eAsync.lock);
+    if(!eAsync.head)
+      break;                            // stop, the queue got drained
+
+    unsigned n = 0;
+    for( ; n < EASYNC_BATCH && eAsync.head; ++n) {
+      batch[n] = eAsync.head;
+      eAsync.head = eAsync.head->next;
+    }
+    if(!eAsync.head)
+      eAsync.tail = &eAsync.head;
+    pthread_mutex_unlock(&eAsync.lock);
+
+    for(unsigned i = 0; i < n; ++i)
+      batch[i]->result = eXferRun(batch[i]);
+
+    pthread_mutex_lock(&eAsync.lock);
+    for(unsigned i = 0; i < n; ++i) {
+      batch[i]->done = 1;
+      if(batch[i]->fd >= 0 && eventfd_write(batch[i]->fd, 1))
+        eCoresWarn("eventfd of transfer %p not signalled\n", (void*)batch[i]);
+    }
+    pthread_cond_broadcast(&eAsync.done);
+  }
+  pthread_mutex_unlock(&eAsync.lock);
+  return NULL;
+}
+
+// eAsync.lock held
+static int eAsyncStartLocked(int cpu, unsigned workers)
+{
+  // exiting workers take no transfers anymore, these would strand
+  if(eAsync.stop) {
+    eCoresError("Transfer workers are stopping!\n");
+    return -1;
+  }
+  if(eAsync.workers)
+    return 0;
+  if(!workers || workers > EASYNC_MAX_WORKERS)
+    workers = workers ? EASYNC_MAX_WORKERS : 1;
+
+  for(unsigned i = 0; i < workers; ++i) {
+    if(pthread_create(&eAsync.thread[i], NULL, eAsyncWorker, NULL))
+      break;
+    if(cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      if(pthread_setaffinity_np(eAsync.thread[i], sizeof(set), &set))
+        eCoresWarn("Could not pin transfer worker to CPU %d\n", cpu);
+    }
+    ++eAsync.workers;
+  }
+  if(!eAsync.workers) {
+    eCoresError("Could not start transfer workers!\n");
+    return -1;
+  }
+  eCoresPrintf(E_DBG, "%u transfer worker(s) on CPU %d\n", eAsync.workers, cpu);
+  return 0;
+}
+
+int eAsyncStart(int cpu, unsigned workers)
+{
+  pthread_mutex_lock(&eAsync.lock);
+  int ret = eAsyncStartLocked(cpu, workers);
+  pthread_mutex_unlock(&eAsync.lock);
+  return ret;
+}
+
+void eAsyncStop(void)
+{
+  pthread_mutex_lock(&eAsync.lock);
+  unsigned workers = eAsync.workers;
+  eAsync.stop = 1;
+  pthread_cond_broadcast(&eAsync.work);
+  pthread_mutex_unlock(&eAsync.lock);
+
+  for(unsigned i = 0; i < workers; ++i)
+    pthread_join(eAsync.thread[i], NULL);
+
+  pthread_mutex_lock(&eAsync.lock);
+  eAsync.workers = 0;
+  eAsync.stop = 0;
+  pthread_mutex_unlock(&eAsync.lock);
+}
+
+static eXfer_t* eXferNew(eXferType_t type, void *dst, const void *src, size_t size)
+{
+  eXfer_t *xfer = calloc(1, sizeof(*xfer));
+  if(!xfer) {
+    eCoresError("Could not allocate transfer!\n");
+    return NULL;
+  }
+  xfer->type = type;
+  xfer->dst = dst;
+  xfer->src = src;
+  xfer->size = size;
+  xfer->fd = -1;
+  return xfer;
+}
+
+eXfer_t* eXferWrite(volatile void *dst, const void *src, size_t size)
+{
+  return eXferNew(EXFER_WRITE, (void*)dst, src, size);
+}
+
+eXfer_t* eXferRead(void *dst, const volatile void *src, size_t size)
+{
+  return eXferNew(EXFER_READ, dst, (const void*)src, size);
+}
+
+eXfer_t* eXferWritev(const eWriteVec_t *vec, unsigned n)
+{
+  return eXferNew(EXFER_WRITEV, NULL, vec, n);
+}
+
+int eXferSubmit(eXfer_t **xfers, unsigned n)
+{
+  assert( xfers || !n );
+
+  pthread_mutex_lock(&eAsync.lock);
+  if(!eAsync.workers || eAsync.stop) {
+    const char *cpu = getenv("EHAL_ASYNC_CPU");
+    const char *workers = getenv("EHAL_ASYNC_WORKERS");
+    if(eAsyncStartLocked(cpu ? atoi(cpu) : -1, workers ? (unsigned)atoi(workers) : 1)) {
+      pthread_mutex_unlock(&eAsync.lock);
+      return -1;
+    }
+  }
+  for(unsigned i = 0; i < n; ++i) {
+    assert( xfers[i] );
+    xfers[i]->next = NULL;
+    xfers[i]->submitted = 1;
+    *eAsync.tail = xfers[i];
+    eAsync.tail = &xfers[i]->next;
+  }
+  // a worker takes up to EASYNC_BATCH, a batch is for all of them
+  if(n > 1)
+    pthread_cond_broadcast(&eAsync.work);
+  else
+    pthread_cond_signal(&eAsync.work);
+  pthread_mutex_unlock(&eAsync.lock);
+  return 0;
+}
+
+int eXferPoll(eXfer_t *xfer)
+{
+  assert( xfer );
+  pthread_mutex_lock(&eAsync.lock);
+  int done = xfer->done;
+  pthread_mutex_unlock(&eAsync.lock);
+  return done;
+}
+
+ssize_t eXferWait(eXfer_t *xfer)
+{
+  assert( xfer );
+  pthread_mutex_lock(&eAsync.lock);
+  if(!xfer->submitted) {
+    pthread_mutex_unlock(&eAsync.lock);
+    eCoresError("Waiting for a transfer never submitted!\n");
+    return -1;
+  }
+  while(!xfer->done)
+    pthread_cond_wait(&eAsync.done, &eAsync.lock);
+  pthread_mutex_unlock(&eAsync.lock);
+  return xfer->result;
+}
+
+int eXferFd(eXfer_t *xfer)
+{
+  assert( xfer );
+  pthread_mutex_lock(&eAsync.lock);
+  if(xfer->fd < 0) {
+    xfer->fd = eventfd(xfer->done, EFD_CLOEXEC);
+    if(xfer->fd < 0)
+      eCoresError("Could not create eventfd (errno %d)!\n", errno);
+  }
+  int fd = xfer->fd;
+  pthread_mutex_unlock(&eAsync.lock);
+  return fd;
+}
+
+void eXferFree(eXfer_t *xfer)
+{
+  if(!xfer)
+    return;
+  if(xfer->submitted)
+    eXferWait(xfer);
+  if(xfer->fd >= 0)
+    close(xfer->fd);
+  free(xfer);
+}
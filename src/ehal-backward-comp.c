@@ -9,7 +9,16 @@
 #include <sys/mman.h>
 
 #include "e-hal.h"
+#include "ehal.h"
+#include "alloc/ehal-region.h"
+#include "loader/ehal-data-loader.h"
 #include "loader/ehal-srec-loader.h"
+#include "ehal-copy.h"
+#include "ehal-async.h"
+#include "ehal-dma.h"
+#include "ehal-shadow.h"
+#include "ehal-tile.h"
+#include "ehal-writev.h"
 #include "state/ehal-state.h"
 
 
@@ -288,17 +297,16 @@ int e_alloc(e_mem_t *mbuf, off_t offset, size_t size)
 	mbuf->page_offset = mbuf->phy_base - mbuf->page_base;
 	mbuf->map_size = size + mbuf->page_offset;
 
-  mbuf->mapped_base = (void*)cfg->lemem->epi_base;
-
-	mbuf->base = (void*)(((char*)mbuf->mapped_base) + mbuf->page_offset);
-
 	mbuf->ephy_base = e_platform.emem[0].ephy_base + offset; // TODO: this takes only the 1st segment into account
 	mbuf->emap_size = size;
 
-
-// HACK for now
-  mbuf->base = mspace_malloc(cfg->lemem->space, size);
-  printf("--- %p\n", mbuf->base );
+	// eMem is mapped already, solely reserve the exact offset
+	if (offset < 0 || size > UINT32_MAX
+	    || !(mbuf->base = eRegionReserve(cfg->lemem, (uint32_t)offset, (uint32_t)size))) {
+		fprintf(stderr, "e_alloc(): Could not reserve eMem at offset 0x%lx!\n", (long)offset);
+		return E_ERR;
+	}
+	mbuf->mapped_base = (char*)mbuf->base - mbuf->page_offset;
 
 	return E_OK;
 }
@@ -306,7 +314,8 @@ int e_alloc(e_mem_t *mbuf, off_t offset, size_t size)
 // Free a memory buffer in external memory
 int e_free(e_mem_t *mbuf)
 {
-  mspace_free(cfg->lemem->space, mbuf->base);
+	if (eRegionRelease(cfg->lemem, (uint32_t)((char*)mbuf->base - cfg->lemem->epi_base)))
+		return E_ERR;
 	return E_OK;
 }
 
@@ -326,7 +335,7 @@ ssize_t ee_write_buf(e_epiphany_t *dev, unsigned row, unsigned col, off_t to_add
 {
 	volatile unsigned char *pto = cfg->lchip->eCoreRoot[row][col].sram + to_addr;
 	assert(dev->core[row][col].mems.base == cfg->lchip->eCoreRoot[row][col].sram);
-	memcpy((char*)pto, buf, size);
+	eCopy(pto, buf, size);
 
 	return size;
 }
@@ -339,7 +348,7 @@ ssize_t ee_write_reg(e_epiphany_t *dev, unsigned row, unsigned col, off_t to_add
   eCoreRegs_t* regs = &cfg->lchip->eCoreRoot[row][col].regs;
   assert(regs == dev->core[row][col].regs.base);
 
-  *(int*)(((char*)regs) + to_addr) = data;
+  eRegStore((volatile uint32_t*)(((char*)regs) + to_addr), data);
 
 	return sizeof(int);
 }
@@ -348,10 +357,31 @@ ssize_t ee_write_reg(e_epiphany_t *dev, unsigned row, unsigned col, off_t to_add
 ssize_t ee_mwrite_buf(e_mem_t *mbuf, off_t to_addr, const void *buf, size_t size)
 {
 	void* pto = mbuf->base + to_addr;
-	memcpy(pto, buf, size);
+	eCopy(pto, buf, size);
 	return size;
 }
 
+// Load a file into a memory buffer in external memory
+ssize_t e_load_data(e_mem_t *mbuf, off_t to_addr, const char *fname, off_t foff, size_t size)
+{
+	if (to_addr < 0 || (size_t)to_addr > mbuf->emap_size
+	    || size > mbuf->emap_size - to_addr)
+		return E_ERR;
+	// 0 fills the buffer from to_addr on
+	if (!size)
+		size = mbuf->emap_size - to_addr;
+	return load_data(fname, foff, (char*)mbuf->base + to_addr, size);
+}
+
+// Store a memory buffer in external memory to a file
+ssize_t e_store_data(e_mem_t *mbuf, off_t from_addr, const char *fname, off_t foff, size_t size)
+{
+	if (from_addr < 0 || (size_t)from_addr > mbuf->emap_size
+	    || size > mbuf->emap_size - from_addr)
+		return E_ERR;
+	return store_data(fname, foff, (char*)mbuf->base + from_addr, size);
+}
+
 // Write a memory block to a core in a group
 ssize_t e_write(void *dev, unsigned row, unsigned col, off_t to_addr, const void *buf, size_t size)
 {
@@ -380,6 +410,223 @@ ssize_t e_write(void *dev, unsigned row, unsigned col, off_t to_addr, const void
 	return wcount;
 }
 
+// In place view of the SRAM of a core in a group resp. of a buffer in external memory
+eView_t e_view(void *dev, unsigned row, unsigned col, off_t addr, size_t size)
+{
+	eView_t       none = { NULL, 0 };
+	e_epiphany_t *edev;
+	e_mem_t      *mdev;
+
+	if (!dev || addr < 0)
+		return none;
+
+	switch (*(e_objtype_t*) dev) {
+	case E_EPI_GROUP:
+		edev = (e_epiphany_t*) dev;
+		if (row >= edev->rows || col >= edev->cols
+		    || (size_t)addr >= edev->core[row][col].mems.map_size)
+			return none;
+		assert(edev->core[row][col].mems.base == cfg->lchip->eCoreRoot[row][col].sram);
+		return eCoreView(row, col, addr, size);
+
+	case E_EXT_MEM:
+		mdev = (e_mem_t *) dev;
+		if ((size_t)addr > mdev->emap_size || size > mdev->emap_size - addr)
+			return none;
+		return eMemView((char*)mdev->base + addr, size);
+
+	default:
+		return none;
+	}
+}
+
+// Write a list of memory blocks to SRAM of cores in a group
+ssize_t e_writev(e_epiphany_t *dev, const e_iovec_t *iov, unsigned n)
+{
+	if (!dev || (!iov && n))
+		return E_ERR;
+
+	eWriteVec_t *vec = malloc((n ? n : 1) * sizeof(*vec));
+	if (!vec)
+		return E_ERR;
+	for (unsigned i = 0; i < n; ++i) {
+		if (iov[i].row >= dev->rows || iov[i].col >= dev->cols
+		    || iov[i].offset < 0 || iov[i].offset >= dev->core[iov[i].row][iov[i].col].mems.map_size) {
+			free(vec);
+			return E_ERR;
+		}
+		assert(dev->core[iov[i].row][iov[i].col].mems.base == cfg->lchip->eCoreRoot[iov[i].row][iov[i].col].sram);
+		vec[i] = (eWriteVec_t){ iov[i].row, iov[i].col, iov[i].offset, iov[i].buf, iov[i].size };
+	}
+	ssize_t wcount = eWritev(cfg, vec, n);
+	free(vec);
+	return wcount < 0 ? E_ERR : wcount;
+}
+
+static ssize_t ee_tile(e_epiphany_t *dev, off_t addr, const void *matrix,
+                       unsigned tile_rows, unsigned tile_cols,
+                       size_t elem_size, size_t stride, int scatter)
+{
+	if (!dev || addr < 0 || (size_t)addr >= dev->core[0][0].mems.map_size)
+		return E_ERR;
+	assert(dev->core[0][0].mems.base == cfg->lchip->eCoreRoot[0][0].sram);
+
+	eTile_t tile = {
+		.row = 0, .col = 0, .rows = dev->rows, .cols = dev->cols,
+		.offset = addr,
+		.tileRows = tile_rows, .tileCols = tile_cols, .elem = elem_size,
+		.stride = stride
+	};
+	ssize_t count = scatter ? eTileScatter(cfg, &tile, matrix)
+	                        : eTileGather(cfg, &tile, (void*)matrix);
+	return count < 0 ? E_ERR : count;
+}
+
+ssize_t e_tile_scatter(e_epiphany_t *dev, off_t to_addr, const void *matrix,
+                       unsigned tile_rows, unsigned tile_cols,
+                       size_t elem_size, size_t stride)
+{
+	return ee_tile(dev, to_addr, matrix, tile_rows, tile_cols, elem_size, stride, 1);
+}
+
+ssize_t e_tile_gather(e_epiphany_t *dev, off_t from_addr, void *matrix,
+                      unsigned tile_rows, unsigned tile_cols,
+                      size_t elem_size, size_t stride)
+{
+	return ee_tile(dev, from_addr, matrix, tile_rows, tile_cols, elem_size, stride, 0);
+}
+
+// Read a memory block from SRAM of a core in a group
+ssize_t ee_read_buf(e_epiphany_t *dev, unsigned row, unsigned col, off_t from_addr, void *buf, size_t size)
+{
+	eCoreMemMap_t* eCore = &cfg->lchip->eCoreRoot[row][col];
+	assert(dev->core[row][col].mems.base == eCore->sram);
+	if (from_addr < 0)
+		return E_ERR;
+	return eDmaRead(cfg, eCore, from_addr, buf, size);
+}
+
+int ee_read_reg(e_epiphany_t *dev, unsigned row, unsigned col, off_t from_addr)
+{
+	if (from_addr >= E_REG_R0)
+		from_addr -= E_REG_R0;
+
+  eCoreRegs_t* regs = &cfg->lchip->eCoreRoot[row][col].regs;
+  assert(regs == dev->core[row][col].regs.base);
+
+	return *(volatile int*)(((char*)regs) + from_addr);
+}
+
+// Read a block from an external memory buffer
+ssize_t ee_mread_buf(e_mem_t *mbuf, off_t from_addr, void *buf, size_t size)
+{
+	if (from_addr < 0 || (size_t)from_addr > mbuf->emap_size
+	    || size > mbuf->emap_size - from_addr)
+		return E_ERR;
+	eCopyFrom(buf, (char*)mbuf->base + from_addr, size);
+	return size;
+}
+
+// Read a memory block from a core in a group
+ssize_t e_read(void *dev, unsigned row, unsigned col, off_t from_addr, void *buf, size_t size)
+{
+	ssize_t       rcount;
+	e_epiphany_t *edev;
+	e_mem_t      *mdev;
+
+	switch (*(e_objtype_t*) dev) {
+	case E_EPI_GROUP:
+		edev = (e_epiphany_t*) dev;
+		if (from_addr < edev->core[row][col].mems.map_size)
+			rcount = ee_read_buf(edev, row, col, from_addr, buf, size);
+		else {
+			*(int*) buf = ee_read_reg(edev, row, col, from_addr);
+			rcount = sizeof(int);
+		}
+		break;
+
+	case E_EXT_MEM:
+		mdev = (e_mem_t *) dev;
+		rcount = ee_mread_buf(mdev, from_addr, buf, size);
+		break;
+
+	default:
+		rcount = 0;
+	}
+
+	return rcount;
+}
+
+// host address of a transfer of size bytes, NULL if out of bounds
+static void* ee_async_addr(void *dev, unsigned row, unsigned col, off_t addr, size_t size)
+{
+	e_epiphany_t *edev;
+	e_mem_t      *mdev;
+
+	if (addr < 0)
+		return NULL;
+	switch (*(e_objtype_t*) dev) {
+	case E_EPI_GROUP:
+		edev = (e_epiphany_t*) dev;
+		if (row >= edev->rows || col >= edev->cols
+		    || (size_t)addr > edev->core[row][col].mems.map_size
+		    || size > edev->core[row][col].mems.map_size - addr)
+			return NULL;
+		return (void*)(cfg->lchip->eCoreRoot[row][col].sram + addr);
+
+	case E_EXT_MEM:
+		mdev = (e_mem_t *) dev;
+		if ((size_t)addr > mdev->emap_size || size > mdev->emap_size - addr)
+			return NULL;
+		return (char*)mdev->base + addr;
+
+	default:
+		return NULL;
+	}
+}
+
+static e_async_t* ee_async_submit(eXfer_t *xfer)
+{
+	if (xfer && eXferSubmit(&xfer, 1)) {
+		eXferFree(xfer);
+		return NULL;
+	}
+	return xfer;
+}
+
+// Write a memory block to a core in a group or to external memory, asynchronously
+e_async_t* e_write_async(void *dev, unsigned row, unsigned col, off_t to_addr, const void *buf, size_t size)
+{
+	void *pto = ee_async_addr(dev, row, col, to_addr, size);
+	return pto ? ee_async_submit(eXferWrite(pto, buf, size)) : NULL;
+}
+
+// Read a memory block from a core in a group or from external memory, asynchronously
+e_async_t* e_read_async(void *dev, unsigned row, unsigned col, off_t from_addr, void *buf, size_t size)
+{
+	void *pfrom = ee_async_addr(dev, row, col, from_addr, size);
+	return pfrom ? ee_async_submit(eXferRead(buf, pfrom, size)) : NULL;
+}
+
+int e_async_poll(e_async_t *handle)
+{
+	return eXferPoll(handle) ? E_TRUE : E_FALSE;
+}
+
+int e_async_fd(e_async_t *handle)
+{
+	return eXferFd(handle);
+}
+
+ssize_t e_async_wait(e_async_t *handle)
+{
+	if (!handle)
+		return E_ERR;
+	ssize_t count = eXferWait(handle);
+	eXferFree(handle);
+	return count;
+}
+
 // ------------------------------------------------------------
 
 int e_reset_system(e_epiphany_t *dev)
@@ -388,6 +635,11 @@ int e_reset_system(e_epiphany_t *dev)
 		fprintf(stderr, "ERROR: Can't connect to Epiphany or external memory.\n");
 		return E_ERR;
 	}
+	// the system belongs to the broker, a lease has no FPGA regs mapped
+	if (cfg->leased) {
+		fprintf(stderr, "e_reset_system(): Not permitted on a lease of the broker.\n");
+		return E_ERR;
+	}
 
 //	printf("Writing 0 to E_SYS_RESET:\n");
 	ee_write_esys(/* E_SYS_RESET =  E_SYS_REG_BASE + 0x0004, E_SYS_REG_BASE  = 0x00000000 */0x4, 0); // 0x4
@@ -453,7 +705,7 @@ int ee_set_core_config_range(e_epiphany_t *pEpiphany,
 
       eCoreMemMapSW_t* cur = (eCoreMemMapSW_t*)(r | c);
       //memcpy(&cur->grpcfg, &backComp, sizeof(backComp));
-      memcpy(&cur->____PADDING[0], &backComp, sizeof(backComp));
+      eCopy(&cur->____PADDING[0], &backComp, sizeof(backComp));
     }
   }
 
@@ -479,6 +731,8 @@ int e_load_group(char *executable, e_epiphany_t *dev,
 
   if(start == E_TRUE) {
     int SYNC = (1 << E_SYNC);
+    eRegWrite_t buf[64];
+    eRegBatch_t batch = EREG_BATCH_INIT( buf );
 
 #if 1
     for(uintptr_t r = ECORE_MASK_ROWID( eCoreBgn );
@@ -492,9 +746,12 @@ int e_load_group(char *executable, e_epiphany_t *dev,
           c >= ECORE_MASK_COLID( eCoreBgn ); c -= ECORE_ONE_COL) {
 #endif
         eCoreMemMap_t* cur = (eCoreMemMap_t*)(r | c);
-        cur->regs.ilatst = SYNC;
+        // the program owns its registers from now on
+        eRegForgetCore(cur);
+        eRegBatchStore(&batch, &cur->regs.ilatst, SYNC);
       }
     }
+    eRegBatchFlush(&batch);
   }
 
   return E_OK;
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include "ehal-banks.h"
+#include "ehal-print.h"
+
+#define EBANK_SRAM          (EBANK_NUM * EBANK_SIZE)
+
+static const char* eBankAgentStr[EBANK_AGENTS] = { "fetch", "ld/st", "dma", "mesh" };
+
+
+void eBankPlanInit(eBankPlan_t *plan)
+{
+  assert( plan );
+
+  for(unsigned b = 0; b < EBANK_NUM; ++b) {
+    plan->lo[b][0] = b * EBANK_SIZE;
+    plan->hi[b][0] = (b + 1) * EBANK_SIZE;
+    for(unsigned w = 1; w < EBANK_WINDOWS; ++w)
+      plan->lo[b][w] = plan->hi[b][w] = 0;
+    for(unsigned a = 0; a < EBANK_AGENTS; ++a)
+      plan->load[b][a] = 0;
+  }
+}
+
+inline static void eBankLoad(eBankPlan_t *plan, unsigned b, unsigned access, unsigned weight)
+{
+  for(unsigned a = 0; a < EBANK_AGENTS; ++a)
+    if(access & (1u << a))
+      plan->load[b][a] += weight;
+}
+
+// takes [bgn, end) out of the free windows of bank b, returns the bytes
+// given up as a split found no unused window
+static uint32_t eBankCarve(eBankPlan_t *plan, unsigned b, uint32_t bgn, uint32_t end)
+{
+  uint32_t lost = 0;
+  for(unsigned w = 0; w < EBANK_WINDOWS; ++w) {
+    uint32_t lo = plan->lo[b][w], hi = plan->hi[b][w];
+    if(lo >= hi || end <= lo || bgn >= hi)
+      continue;
+    if(bgn <= lo && end >= hi)
+      plan->hi[b][w] = lo;
+    else if(bgn <= lo)
+      plan->lo[b][w] = end;
+    else if(end >= hi)
+      plan->hi[b][w] = bgn;
+    else {
+      unsigned u;
+      for(u = 0; u < EBANK_WINDOWS && plan->lo[b][u] < plan->hi[b][u]; ++u);
+      if(u < EBANK_WINDOWS) {
+        plan->lo[b][u] = end;
+        plan->hi[b][u] = hi;
+        plan->hi[b][w] = bgn;
+      }
+      // out of windows, keep the larger side
+      else if(bgn - lo >= hi - end) {
+        lost += hi - end;
+        plan->hi[b][w] = bgn;
+      }
+      else {
+        lost += bgn - lo;
+        plan->lo[b][w] = end;
+      }
+    }
+  }
+  return lost;
+}
+
+// end of the free window of bank b starting at lo, lo if there is none
+static uint32_t eBankFreeFrom(const eBankPlan_t *plan, unsigned b, uint32_t lo)
+{
+  for(unsigned w = 0; w < EBANK_WINDOWS; ++w)
+    if(plan->lo[b][w] == lo && plan->hi[b][w] > lo)
+      return plan->hi[b][w];
+  return lo;
+}
+
+int eBankPlanReserve(eBankPlan_t *plan, uint32_t offset, uint32_t size,
+                     unsigned access, unsigned weight)
+{
+  assert( plan );
+
+  if(offset > EBANK_SRAM || size > EBANK_SRAM - offset) {
+    eCoresError("SRAM range 0x%x+0x%x out of bounds!\n", offset, size);
+    return -1;
+  }
+
+  for(unsigned b = offset / EBANK_SIZE; size && b < EBANK_NUM && b * EBANK_SIZE < offset + size; ++b) {
+    uint32_t bgn = offset > b * EBANK_SIZE ? offset : b * EBANK_SIZE;
+    uint32_t end = offset + size < (b + 1) * EBANK_SIZE ? offset + size : (b + 1) * EBANK_SIZE;
+
+    uint32_t lost = eBankCarve(plan, b, bgn, end);
+    if(lost)
+      eCoresWarn("SRAM bank %u: %u free bytes given up, more than %u free windows\n",
+                 b, lost, EBANK_WINDOWS);
+
+    eBankLoad(plan, b, access, weight);
+  }
+  return 0;
+}
+
+// offset of buf starting in window w of bank b, ~0 if it does not fit
+static uint32_t eBankFit(const eBankPlan_t *plan, const eBankBuf_t *buf, unsigned b, unsigned w)
+{
+  uint32_t lo = plan->lo[b][w], hi = plan->hi[b][w];
+  uint32_t align = buf->align ? buf->align : 8;
+  uint32_t off = (lo + align - 1) & ~(align - 1);
+  uint32_t end = off + buf->size;
+  if(off >= hi || end > EBANK_SRAM)
+    return ~0u;
+  if(end <= hi)
+    return off;
+
+  // spans into the following banks, these have to be free up to its end
+  if(hi != (b + 1) * EBANK_SIZE)
+    return ~0u;
+  unsigned last = (end - 1) / EBANK_SIZE;
+  for(unsigned j = b + 1; j <= last; ++j)
+    if(eBankFreeFrom(plan, j, j * EBANK_SIZE) < (j < last ? (j + 1) * EBANK_SIZE : end))
+      return ~0u;
+  return off;
+}
+
+// weighted load of the other agents in the banks covered by [off, off+size)
+static uint64_t eBankCost(const eBankPlan_t *plan, const eBankBuf_t *buf, uint32_t off)
+{
+  uint64_t cost = 0;
+  unsigned last = (off + (buf->size ? buf->size : 1) - 1) / EBANK_SIZE;
+  for(unsigned j = off / EBANK_SIZE; j <= last; ++j)
+    for(unsigned a = 0; a < EBANK_AGENTS; ++a)
+      if(!(buf->access & (1u << a)))
+        cost += (uint64_t)plan->load[j][a] * buf->weight;
+  return cost;
+}
+
+static int eBankOrder(const void *l, const void *r)
+{
+  const eBankBuf_t *a = *(const eBankBuf_t* const*)l;
+  const eBankBuf_t *b = *(const eBankBuf_t* const*)r;
+  // pinned first, then the heaviest, then the largest
+  if((a->bank >= 0) != (b->bank >= 0))
+    return a->bank >= 0 ? -1 : 1;
+  if(a->weight != b->weight)
+    return a->weight > b->weight ? -1 : 1;
+  if(a->size != b->size)
+    return a->size > b->size ? -1 : 1;
+  return a < b ? -1 : 1;
+}
+
+int eBankPlace(eBankPlan_t *plan, eBankBuf_t *bufs, unsigned n)
+{
+  assert( plan );
+  assert( bufs || !n );
+
+  eBankBuf_t **order = malloc((n ? n : 1) * sizeof(*order));
+  if(!order) {
+    eCoresError("Could not allocate SRAM plan!\n");
+    return -1;
+  }
+  for(unsigned i = 0; i < n; ++i)
+    order[i] = &bufs[i];
+  qsort(order, n, sizeof(*order), eBankOrder);
+
+  int ret = 0;
+  for(unsigned i = 0; i < n && !ret; ++i) {
+    eBankBuf_t *buf = order[i];
+    assert( !buf->align || !(buf->align & (buf->align - 1)) );
+
+    unsigned best = EBANK_NUM;
+    uint32_t bestOff = 0, bestLo = 0, bestLeft = 0;
+    uint64_t bestCost = 0;
+    for(unsigned b = 0; b < EBANK_NUM; ++b) {
+      if(buf->bank >= 0 && (unsigned)buf->bank != b)
+        continue;
+      for(unsigned w = 0; w < EBANK_WINDOWS; ++w) {
+        uint32_t off = eBankFit(plan, buf, b, w);
+        if(off == ~0u)
+          continue;
+        uint64_t cost = eBankCost(plan, buf, off);
+        // among equal costs the tightest fit, keeps large windows for large buffers
+        uint32_t end = off + buf->size, hi = plan->hi[b][w];
+        if(end > hi)
+          hi = eBankFreeFrom(plan, (end - 1) / EBANK_SIZE, (end - 1) / EBANK_SIZE * EBANK_SIZE);
+        uint32_t left = hi - end;
+        if(best == EBANK_NUM || cost < bestCost
+           || (cost == bestCost && left < bestLeft)) {
+          best = b;
+          bestOff = off;
+          bestLo = plan->lo[b][w];
+          bestCost = cost;
+          bestLeft = left;
+        }
+      }
+    }
+
+    if(best == EBANK_NUM) {
+      eCoresError("SRAM buffer '%s' (%u bytes) does not fit%s!\n",
+                  buf->name ? buf->name : "?", buf->size, buf->bank >= 0 ? " its bank" : "");
+      ret = -1;
+      break;
+    }
+
+    // the alignment padding in front goes along, no window gets split
+    buf->offset = bestOff;
+    uint32_t end = bestOff + buf->size;
+    for(unsigned j = bestOff / EBANK_SIZE; j <= (end - !!buf->size) / EBANK_SIZE; ++j) {
+      uint32_t bgn = bestLo > j * EBANK_SIZE ? bestLo : j * EBANK_SIZE;
+      eBankCarve(plan, j, bgn, end < (j + 1) * EBANK_SIZE ? end : (j + 1) * EBANK_SIZE);
+      eBankLoad(plan, j, buf->access, buf->weight);
+    }
+  }
+  free(order);
+  if(ret)
+    return ret;
+
+  // contention left over
+  for(unsigned b = 0; b < EBANK_NUM; ++b) {
+    char agents[32] = "";
+    unsigned cnt = 0, len = 0;
+    for(unsigned a = 0; a < EBANK_AGENTS; ++a)
+      if(plan->load[b][a]) {
+        len += snprintf(agents + len, sizeof(agents) - len, "%s%s", cnt ? "+" : "", eBankAgentStr[a]);
+        ++cnt;
+      }
+    if(cnt > 1) {
+      eCoresWarn("SRAM bank %u contended by %s\n", b, agents);
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+int eBankPlanApply(const eBankBuf_t *bufs, unsigned n, uint32_t table,
+                   eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd)
+{
+  assert( bufs || !n );
+  assert( eCoreBgn );
+  assert( eCoreEnd );
+
+  if(table & 0x3 || table > EBANK_SRAM || n > (EBANK_SRAM - table) / sizeof(uint32_t)) {
+    eCoresError("SRAM offset table at 0x%x invalid!\n", table);
+    return -1;
+  }
+
+  for(uintptr_t r = ECORE_MASK_ROWID( eCoreBgn );
+      r <= ECORE_MASK_ROWID( eCoreEnd ); r += ECORE_ONE_ROW) {
+    for(uintptr_t c = ECORE_MASK_COLID( eCoreBgn );
+        c <= ECORE_MASK_COLID( eCoreEnd ); c += ECORE_ONE_COL) {
+      eCoreMemMap_t* cur = (eCoreMemMap_t*)(r | c);
+      volatile uint32_t *dst = (volatile uint32_t*)(cur->sram + table);
+      for(unsigned i = 0; i < n; ++i)
+        dst[i] = bufs[i].offset;
+    }
+  }
+  return 0;
+}
+
+void eBankPlanHeader(FILE *out, const char *prefix, const eBankBuf_t *bufs, unsigned n)
+{
+  assert( out );
+  assert( bufs || !n );
+
+  for(unsigned i = 0; i < n; ++i) {
+    fprintf(out, "#define %s", prefix ? prefix : "");
+    for(const char *s = bufs[i].name ? bufs[i].name : "BUF"; *s; ++s)
+      fputc(isalnum((unsigned char)*s) ? toupper((unsigned char)*s) : '_', out);
+    fprintf(out, " 0x%04x\n", bufs[i].offset);
+  }
+}
+
+void eBankPlanPrint(FILE *out, const eBankPlan_t *plan, const eBankBuf_t *bufs, unsigned n)
+{
+  assert( out );
+  assert( plan );
+  assert( bufs || !n );
+
+  for(unsigned b = 0; b < EBANK_NUM; ++b) {
+    fprintf(out, "bank %u: free", b);
+    for(unsigned w = 0; w < EBANK_WINDOWS; ++w)
+      if(plan->lo[b][w] < plan->hi[b][w])
+        fprintf(out, " 0x%04x-0x%04x", plan->lo[b][w], plan->hi[b][w]);
+    fprintf(out, ", load");
+    for(unsigned a = 0; a < EBANK_AGENTS; ++a)
+      fprintf(out, " %s %u", eBankAgentStr[a], plan->load[b][a]);
+    fputc('\n', out);
+    for(unsigned i = 0; i < n; ++i)
+      if(bufs[i].offset / EBANK_SIZE == b)
+        fprintf(out, "  0x%04x %6u %s\n", bufs[i].offset, bufs[i].size,
+                bufs[i].name ? bufs[i].name : "?");
+  }
+}
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _POSIX_C_SOURCE 200809L /* O_CLOEXEC */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "ehal-bulk.h"
+#include "ehal-copy.h"
+#include "ehal-print.h"
+
+static struct {
+  pthread_mutex_t lock;
+  const eBulkBackend_t *be;         // NULL until first use
+} eBulk = {
+  .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+
+static int eBulkMemcpyOpen(void)
+{
+  return 0;
+}
+
+static void eBulkMemcpyClose(void)
+{
+}
+
+static int eBulkMemcpyCopy(volatile void *dst, const volatile void *src, size_t size, eBulkDir_t dir)
+{
+  if(dir == EBULK_TO_DEVICE)
+    eCopy(dst, (const void*)src, size);
+  else
+    eCopyFrom((void*)dst, src, size);
+  return 0;
+}
+
+const eBulkBackend_t eBulkMemcpy = {
+  .name = "memcpy",
+  .open = eBulkMemcpyOpen,
+  .close = eBulkMemcpyClose,
+  .copy = eBulkMemcpyCopy
+};
+
+
+static int eBulkPl330Fd = -1;
+
+static int eBulkPl330Open(void)
+{
+  eBulkPl330Fd = open(EBULK_PL330_DEV, O_RDWR | O_CLOEXEC);
+  if(eBulkPl330Fd < 0) {
+    eCoresPrintf(E_DBG, "%s not available (errno %d, %s)\n",
+                 EBULK_PL330_DEV, errno, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+static void eBulkPl330Close(void)
+{
+  if(eBulkPl330Fd >= 0)
+    close(eBulkPl330Fd);
+  eBulkPl330Fd = -1;
+}
+
+static int eBulkPl330Copy(volatile void *dst, const volatile void *src, size_t size, eBulkDir_t dir)
+{
+  (void)dir;                            // the driver maps both ranges
+  eBulkPl330Copy_t xfer = {
+    .dst = (uintptr_t)dst,
+    .src = (uintptr_t)src,
+    .size = size
+  };
+  int ret;
+  do
+    ret = ioctl(eBulkPl330Fd, EBULK_PL330_COPY, &xfer);
+  while(ret && errno == EINTR);
+  return ret;
+}
+
+const eBulkBackend_t eBulkPl330 = {
+  .name = "pl330",
+  .open = eBulkPl330Open,
+  .close = eBulkPl330Close,
+  .copy = eBulkPl330Copy
+};
+
+
+// eBulk.lock held
+static int eBulkUseLocked(const eBulkBackend_t *be)
+{
+  if(eBulk.be)
+    eBulk.be->close();
+  eBulk.be = NULL;
+  if(!be)
+    return 0;
+
+  int ret = 0;
+  if(be->open()) {
+    eCoresWarn("Bulk transfer backend %s not available, using %s\n",
+               be->name, eBulkMemcpy.name);
+    be = &eBulkMemcpy;
+    be->open();
+    ret = -1;
+  }
+  eCoresPrintf(E_DBG, "Bulk transfers via %s\n", be->name);
+  __atomic_store_n(&eBulk.be, be, __ATOMIC_RELEASE);
+  return ret;
+}
+
+int eBulkUse(const eBulkBackend_t *be)
+{
+  assert( be );
+  pthread_mutex_lock(&eBulk.lock);
+  int ret = eBulkUseLocked(be);
+  pthread_mutex_unlock(&eBulk.lock);
+  return ret;
+}
+
+const eBulkBackend_t* eBulkCurrent(void)
+{
+  const eBulkBackend_t *be = __atomic_load_n(&eBulk.be, __ATOMIC_ACQUIRE);
+  if(be)
+    return be;
+
+  pthread_mutex_lock(&eBulk.lock);
+  if(!eBulk.be) {
+    // pl330 solely if asked for, the driver is not part of the tree
+    const char *env = getenv("EHAL_BULK");
+    be = &eBulkMemcpy;
+    if(env && !strcmp(env, eBulkPl330.name))
+      be = &eBulkPl330;
+    else if(env && strcmp(env, eBulkMemcpy.name))
+      eCoresWarn("Unknown bulk transfer backend %s\n", env);
+    eBulkUseLocked(be);
+  }
+  be = eBulk.be;
+  pthread_mutex_unlock(&eBulk.lock);
+  return be;
+}
+
+void eBulkFini(void)
+{
+  pthread_mutex_lock(&eBulk.lock);
+  eBulkUseLocked(NULL);
+  pthread_mutex_unlock(&eBulk.lock);
+}
+
+static ssize_t eBulkCopy(volatile void *dst, const volatile void *src, size_t size, eBulkDir_t dir)
+{
+  if(size >= EBULK_MIN) {
+    const eBulkBackend_t *be = eBulkCurrent();
+    if(!be->copy(dst, src, size, dir))
+      return size;
+    eCoresWarn("Bulk transfer via %s failed (errno %d), copying\n", be->name, errno);
+  }
+  eBulkMemcpyCopy(dst, src, size, dir);
+  return size;
+}
+
+ssize_t eBulkWrite(volatile void *dst, const void *src, size_t size)
+{
+  assert( (dst && src) || !size );
+  return eBulkCopy(dst, src, size, EBULK_TO_DEVICE);
+}
+
+ssize_t eBulkRead(void *dst, const volatile void *src, size_t size)
+{
+  assert( (dst && src) || !size );
+  return eBulkCopy(dst, src, size, EBULK_FROM_DEVICE);
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <string.h>
+#include "ehal-copy.h"
+
+#if defined(__arm__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+// a single 64-bit beat, the compiler may neither merge nor reorder it
+# define eStore64( d, v ) \
+  __asm__ __volatile__("vst1.64 {%P1}, [%0:64]" :: "r"(d), "w"(v) : "memory")
+typedef uint64x1_t eWord64_t;
+# define eLoad64( s )     vreinterpret_u64_u8(vld1_u8((const uint8_t*)(s)))
+# define eSplat64( c )    vreinterpret_u64_u8(vdup_n_u8(c))
+# define eRead64( s )     ({ eWord64_t __v; \
+  __asm__ __volatile__("vld1.64 {%P0}, [%1:64]" : "=w"(__v) : "r"(s) : "memory"); __v; })
+# define eSave64( d, v )  vst1_u8((uint8_t*)(d), vreinterpret_u8_u64(v))
+#else
+# define eStore64( d, v ) (*(volatile uint64_t*)(d) = (v))
+typedef uint64_t eWord64_t;
+# define eLoad64( s )     ({ uint64_t __v; memcpy(&__v, (s), sizeof(__v)); __v; })
+# define eSplat64( c )    (0x0101010101010101ull * (uint8_t)(c))
+# define eRead64( s )     (*(const volatile uint64_t*)(s))
+# define eSave64( d, v )  ({ uint64_t __v = (v); memcpy((d), &__v, sizeof(__v)); })
+#endif
+
+#define eLoad32( s )      ({ uint32_t __v; memcpy(&__v, (s), sizeof(__v)); __v; })
+#define eLoad16( s )      ({ uint16_t __v; memcpy(&__v, (s), sizeof(__v)); __v; })
+
+
+void eCopyBlock(volatile void *dst, const void *src, size_t size)
+{
+  volatile uint8_t *d = dst;
+  const uint8_t *s = src;
+
+  // head, ascending up to the 8 byte boundary
+  if(size >= 1 && ((uintptr_t)d & 1)) {
+    *d = *s;
+    d += 1; s += 1; size -= 1;
+  }
+  if(size >= 2 && ((uintptr_t)d & 2)) {
+    *(volatile uint16_t*)d = eLoad16(s);
+    d += 2; s += 2; size -= 2;
+  }
+  if(size >= 4 && ((uintptr_t)d & 4)) {
+    *(volatile uint32_t*)d = eLoad32(s);
+    d += 4; s += 4; size -= 4;
+  }
+
+  // body, 64-bit writes
+  for( ; size >= 32; d += 32, s += 32, size -= 32) {
+    eWord64_t v0 = eLoad64(s), v1 = eLoad64(s + 8),
+              v2 = eLoad64(s + 16), v3 = eLoad64(s + 24);
+    eStore64(d, v0);
+    eStore64(d + 8, v1);
+    eStore64(d + 16, v2);
+    eStore64(d + 24, v3);
+  }
+  for( ; size >= 8; d += 8, s += 8, size -= 8)
+    eStore64(d, eLoad64(s));
+
+  // tail
+  if(size & 4) {
+    *(volatile uint32_t*)d = eLoad32(s);
+    d += 4; s += 4;
+  }
+  if(size & 2) {
+    *(volatile uint16_t*)d = eLoad16(s);
+    d += 2; s += 2;
+  }
+  if(size & 1)
+    *d = *s;
+}
+
+void eFillBlock(volatile void *dst, uint8_t c, size_t size)
+{
+  volatile uint8_t *d = dst;
+  uint64_t pattern = 0x0101010101010101ull * c;
+
+  if(size >= 1 && ((uintptr_t)d & 1)) {
+    *d = c;
+    d += 1; size -= 1;
+  }
+  if(size >= 2 && ((uintptr_t)d & 2)) {
+    *(volatile uint16_t*)d = (uint16_t)pattern;
+    d += 2; size -= 2;
+  }
+  if(size >= 4 && ((uintptr_t)d & 4)) {
+    *(volatile uint32_t*)d = (uint32_t)pattern;
+    d += 4; size -= 4;
+  }
+
+  eWord64_t v = eSplat64(c);
+  for( ; size >= 8; d += 8, size -= 8)
+    eStore64(d, v);
+
+  if(size & 4) {
+    *(volatile uint32_t*)d = (uint32_t)pattern;
+    d += 4;
+  }
+  if(size & 2) {
+    *(volatile uint16_t*)d = (uint16_t)pattern;
+    d += 2;
+  }
+  if(size & 1)
+    *d = c;
+}
+
+void eCopyFrom(void *dst, const volatile void *src, size_t size)
+{
+  uint8_t *d = dst;
+  const volatile uint8_t *s = src;
+  uint16_t h;
+  uint32_t w;
+
+  if(size >= 1 && ((uintptr_t)s & 1)) {
+    *d = *s;
+    d += 1; s += 1; size -= 1;
+  }
+  if(size >= 2 && ((uintptr_t)s & 2)) {
+    h = *(const volatile uint16_t*)s;
+    memcpy(d, &h, sizeof(h));
+    d += 2; s += 2; size -= 2;
+  }
+  if(size >= 4 && ((uintptr_t)s & 4)) {
+    w = *(const volatile uint32_t*)s;
+    memcpy(d, &w, sizeof(w));
+    d += 4; s += 4; size -= 4;
+  }
+
+  for( ; size >= 8; d += 8, s += 8, size -= 8)
+    eSave64(d, eRead64(s));
+
+  if(size & 4) {
+    w = *(const volatile uint32_t*)s;
+    memcpy(d, &w, sizeof(w));
+    d += 4; s += 4;
+  }
+  if(size & 2) {
+    h = *(const volatile uint16_t*)s;
+    memcpy(d, &h, sizeof(h));
+    d += 2; s += 2;
+  }
+  if(size & 1)
+    *d = *s;
+}
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include "ehal.h"
+#include "ehal-copy.h"
+#include "ehal-dma.h"
+#include "ehal-fence.h"
+#include "ehal-print.h"
+#include "ehal-shadow.h"
+#include "alloc/ehal-tcache.h"
+
+// Host threads serialize the check for an idle channel and the kick per
+// eCore, otherwise two of them find the same channel idle. Striped over the
+// low row and col bits, eCores of a chip do not share a lock.
+#define EDMA_LOCKS          64
+
+static pthread_mutex_t eDmaLocks[EDMA_LOCKS];
+static pthread_once_t eDmaLocksOnce = PTHREAD_ONCE_INIT;
+
+static void eDmaLocksInit(void)
+{
+  for(unsigned i = 0; i < EDMA_LOCKS; ++i)
+    pthread_mutex_init(&eDmaLocks[i], NULL);
+}
+
+static pthread_mutex_t* eDmaLock(eCoreMemMap_t *eCore)
+{
+  pthread_once(&eDmaLocksOnce, eDmaLocksInit);
+  return &eDmaLocks[(ECORE_ADDR_ROWID(eCore) & 7) << 3 | (ECORE_ADDR_COLID(eCore) & 7)];
+}
+
+static unsigned long eDmaNowUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+// contiguous descriptor of inner x outer items of 1 << log2 bytes
+static void eDmaDescItems(eDmaDesc_t *desc, uint32_t dst, uint32_t src,
+                          unsigned log2, uint32_t inner, uint32_t outer)
+{
+  desc->config = EDMA_CONFIG_ENABLE | EDMA_CONFIG_MASTER | EDMA_CONFIG_SIZE( log2 );
+  desc->inner_stride = EDMA_STRIDE( 1u << log2, 1u << log2 );
+  desc->count = (outer << 16) | inner;
+  desc->outer_stride = desc->inner_stride;
+  desc->src_addr = src;
+  desc->dst_addr = dst;
+}
+
+static unsigned eDmaItemLog2(uint32_t bits)
+{
+  return !(bits & 7) ? 3 : !(bits & 3) ? 2 : !(bits & 1) ? 1 : 0;
+}
+
+int eDmaDescCopy(eDmaDesc_t *desc, uint32_t dst, uint32_t src, uint32_t size)
+{
+  assert( desc );
+
+  unsigned log2 = eDmaItemLog2(dst | src | size);
+  if(!size || (size >> log2) > 0xFFFF)
+    return -1;
+  eDmaDescItems(desc, dst, src, log2, size >> log2, 1);
+  return 0;
+}
+
+static int eDmaIdle(eCoreDMA_t *dma)
+{
+  return !dma->config.dmaen && !dma->status.dmastate;
+}
+
+// eDmaLock() held
+static int eDmaStartRegsLocked(eCoreMemMap_t *eCore, unsigned chan, const eDmaDesc_t *desc)
+{
+  eCoreDMA_t *dma = &eCore->regs.dma[chan];
+  if((desc->count >> 16) != 1 || !(desc->count & 0xFFFF)
+     || desc->config & (EDMA_CONFIG_CHAIN | EDMA_CONFIG_STARTUP))
+    return -1;
+  if(!eDmaIdle(dma))
+    return -1;                          // in use by the eCore program
+
+  dma->stride = desc->inner_stride;
+  dma->count.reg = desc->count;
+  dma->srcaddr = desc->src_addr;
+  dma->dstaddr = desc->dst_addr;
+  eRegStore(&dma->config.reg, desc->config | EDMA_CONFIG_ENABLE);  // kicks it off
+  return 0;
+}
+
+int eDmaStartRegs(eCoreMemMap_t *eCore, unsigned chan, const eDmaDesc_t *desc)
+{
+  assert( eCore );
+  assert( desc );
+  assert( chan < sizeof(eCore->regs.dma) / sizeof(eCore->regs.dma[0]) );
+
+  pthread_mutex_t *lock = eDmaLock(eCore);
+  pthread_mutex_lock(lock);
+  int ret = eDmaStartRegsLocked(eCore, chan, desc);
+  pthread_mutex_unlock(lock);
+  return ret;
+}
+
+int eDmaStart(eCoreMemMap_t *eCore, unsigned chan, uint32_t dst, uint32_t src, uint32_t size)
+{
+  eDmaDesc_t desc;
+  if((dst | src | size) & 7 || eDmaDescCopy(&desc, dst, src, size))
+    return -1;
+  return eDmaStartRegs(eCore, chan, &desc);
+}
+
+int eDmaChain(eCoreMemMap_t *eCore, uint32_t offset, const eDmaDesc_t *descs, unsigned n)
+{
+  assert( eCore );
+  assert( descs || !n );
+
+  if(!n || offset & 7 || offset > sizeof(eCore->sram)
+     || n > (sizeof(eCore->sram) - offset) / sizeof(eDmaDesc_t))
+    return -1;
+  for(unsigned i = 0; i < n; ++i) {
+    eDmaDesc_t desc = descs[i];
+    desc.config &= ~(EDMA_CONFIG_NEXT( 0xFFFF ) | EDMA_CONFIG_CHAIN | EDMA_CONFIG_STARTUP);
+    desc.config |= EDMA_CONFIG_ENABLE;
+    if(i + 1 < n)
+      desc.config |= EDMA_CONFIG_CHAIN | EDMA_CONFIG_NEXT( offset + (i + 1) * sizeof(desc) );
+    eCopy(&eCore->sram[offset + i * sizeof(desc)], &desc, sizeof(desc));
+  }
+  return 0;
+}
+
+// eDmaLock() held
+static int eDmaStartDescLocked(eCoreMemMap_t *eCore, unsigned chan, uint32_t desc)
+{
+  eCoreDMA_t *dma = &eCore->regs.dma[chan];
+  if(desc & 7 || desc > sizeof(eCore->sram) - sizeof(eDmaDesc_t))
+    return -1;
+  if(!eDmaIdle(dma))
+    return -1;
+
+  // config gets loaded from the descriptors from now on
+  dma->config.reg = EDMA_CONFIG_NEXT( desc ) | EDMA_CONFIG_STARTUP;
+  eRegForget(&dma->config.reg);
+  return 0;
+}
+
+int eDmaStartDesc(eCoreMemMap_t *eCore, unsigned chan, uint32_t desc)
+{
+  assert( eCore );
+  assert( chan < sizeof(eCore->regs.dma) / sizeof(eCore->regs.dma[0]) );
+
+  pthread_mutex_t *lock = eDmaLock(eCore);
+  pthread_mutex_lock(lock);
+  int ret = eDmaStartDescLocked(eCore, chan, desc);
+  pthread_mutex_unlock(lock);
+  return ret;
+}
+
+int eDmaMove(eCoreMemMap_t *eCore, unsigned chan, uint32_t slot,
+             uint32_t dst, uint32_t src, size_t size)
+{
+  assert( eCore );
+  assert( chan < sizeof(eCore->regs.dma) / sizeof(eCore->regs.dma[0]) );
+
+  if(!size || (uint64_t)size > UINT32_MAX)
+    return -1;
+  eDmaDesc_t desc[EDMA_MOVE_DESCS];
+  unsigned n = 0;
+  // equally aligned ends move the body as double words, else the common
+  // alignment rules throughout
+  uint32_t head = (dst ^ src) & 7 ? 0 : (8 - (src & 7)) & 7;
+  if(head > size)
+    head = size;
+  uint32_t log2 = (dst ^ src) & 7 ? eDmaItemLog2(dst | src) : 3;
+  uint32_t items = (size - head) >> log2;
+  uint32_t tail = size - head - (items << log2);
+  if(items >> 15 > 0xFFFF)
+    return -1;                          // beyond 2^31 bytes of items
+
+  if(head) {
+    unsigned hlog2 = eDmaItemLog2(dst | src | head);
+    eDmaDescItems(&desc[n++], dst, src, hlog2, head >> hlog2, 1);
+  }
+  uint32_t at = head;
+  // rows of 0x8000 items, contiguous
+  if(items > 0xFFFF) {
+    eDmaDescItems(&desc[n++], dst + at, src + at, log2, 0x8000, items >> 15);
+    at += (items >> 15 << 15) << log2;
+    items &= 0x7FFF;
+  }
+  if(items) {
+    eDmaDescItems(&desc[n++], dst + at, src + at, log2, items, 1);
+    at += items << log2;
+  }
+  if(tail) {
+    unsigned tlog2 = eDmaItemLog2(tail);
+    eDmaDescItems(&desc[n++], dst + at, src + at, tlog2, tail >> tlog2, 1);
+  }
+  assert( n <= EDMA_MOVE_DESCS );
+
+  if(n == 1 && (desc[0].count >> 16) == 1)
+    return eDmaStartRegs(eCore, chan, &desc[0]);
+
+  // a busy channel may still fetch descriptors from slot, leave them alone
+  pthread_mutex_t *lock = eDmaLock(eCore);
+  pthread_mutex_lock(lock);
+  int ret = -1;
+  if(eDmaIdle(&eCore->regs.dma[chan]) && !eDmaChain(eCore, slot, desc, n))
+    ret = eDmaStartDescLocked(eCore, chan, slot);
+  pthread_mutex_unlock(lock);
+  return ret;
+}
+
+int eDmaWait(eCoreMemMap_t *eCore, unsigned chan, unsigned long timeoutUs)
+{
+  assert( eCore );
+  assert( chan < sizeof(eCore->regs.dma) / sizeof(eCore->regs.dma[0]) );
+
+  eCoreDMA_t *dma = &eCore->regs.dma[chan];
+  unsigned long bgn = eDmaNowUs();
+  while(dma->status.dmastate)
+    if(eDmaNowUs() - bgn > timeoutUs)
+      return -1;
+  return 0;
+}
+
+// DMA the 8 byte aligned [src, src+size) into an eMem bounce buffer and read
+// it back from DRAM, -1 if the channel is not available
+static int eDmaBounce(eConfig_t *cfg, eCoreMemMap_t *eCore,
+                      const volatile uint8_t *src, void *dst, uint32_t size)
+{
+  // via the thread caches, i.e. under the heap lock where it reaches the slab
+  eConfigMem_t *emem = cfg->lemem;
+  eMemPtr_t bounce = eTcacheAlloc(emem, size);
+  if(!bounce.host)
+    return -1;                          // incl. a heap lost by a rebuild
+
+  // Writes from the DMA engine arrive in order, so once the last double
+  // word landed, all did. Seed it with what it cannot be.
+  uint64_t last, seed;
+  eCopyFrom(&last, src + size - 8, sizeof(last));
+  seed = ~last;
+  volatile uint64_t *tail = (volatile uint64_t*)((char*)bounce.host + size - 8);
+  *tail = seed;
+  eFenceStore();
+
+  // the channel stays ours until the bounce completed resp. got disabled
+  eDmaDesc_t desc;
+  pthread_mutex_t *lock = eDmaLock(eCore);
+  pthread_mutex_lock(lock);
+  if(eDmaDescCopy(&desc, bounce.eaddr, (uint32_t)(uintptr_t)src, size)
+     || eDmaStartRegsLocked(eCore, EDMA_CHANNEL, &desc)) {
+    pthread_mutex_unlock(lock);
+    eTcacheFree(emem, bounce.host);
+    return -1;
+  }
+
+  unsigned long bgn = eDmaNowUs();
+  int ret = eDmaWait(eCore, EDMA_CHANNEL, EDMA_TIMEOUT_US);
+  while(!ret && *tail != last)
+    if(eDmaNowUs() - bgn > EDMA_TIMEOUT_US)
+      ret = -1;
+  if(ret) {
+    // still in flight possibly, hence the bounce buffer is not handed back
+    eRegStore(&eCore->regs.dma[EDMA_CHANNEL].config.reg, 0);
+    pthread_mutex_unlock(lock);
+    eCoresWarn("eCore DMA bounce timed out, reading directly\n");
+    return -1;
+  }
+  pthread_mutex_unlock(lock);
+
+  // through the uncached mapping, the cached aperture may hold stale lines
+  // the DMA engine wrote behind its back
+  eCopyFrom(dst, bounce.host, size);
+  eTcacheFree(emem, bounce.host);
+  return 0;
+}
+
+ssize_t eDmaRead(eConfig_t *cfg, eCoreMemMap_t *eCore, uint32_t offset, void *dst, size_t size)
+{
+  assert( cfg );
+  assert( eCore );
+  assert( dst || !size );
+
+  if(offset > sizeof(eCore->sram) || size > sizeof(eCore->sram) - offset)
+    return -1;
+
+  const volatile uint8_t *src = eCore->sram + offset;
+  // memfd emulation has no DMA engine behind the registers
+  if(cfg->emulated || size < EDMA_BOUNCE_MIN) {
+    eCopyFrom(dst, src, size);
+    return size;
+  }
+
+  uint32_t head = (8 - (offset & 7)) & 7;
+  uint32_t body = (size - head) & ~7u;
+  eCopyFrom(dst, src, head);
+  if(eDmaBounce(cfg, eCore, src + head, (char*)dst + head, body))
+    eCopyFrom((char*)dst + head, src + head, body);
+  eCopyFrom((char*)dst + head + body, src + head + body, size - head - body);
+  return size;
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* memfd_create */
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ehal-emulate.h"
+#include "ehal-mmap.h"
+#include "ehal-print.h"
+
+// Zynq ident registers, see ident-xilinx-zynq.c
+#define SLCR_PSS_IDCODE         (0xF8000000 + 0x530)
+#define DEVCFG_MCTRL            (0xF8007000 + 0x80)
+#define EMU_END                 (0xF8007000 + 0x1000)
+
+#define EMU_ZYNQ_IDCODE         (0x7 << 12)   // 7z020
+#define EMU_ZYNQ_MCTRL          (0x3u << 28)  // silicon v3.1
+
+
+int eEmuRequested(void)
+{
+  const char *env = getenv("EHAL_EMULATE");
+  return env && atoi(env) != 0;
+}
+
+static int eEmuPoke(int fd, uintptr_t addr, uint32_t val)
+{
+  return pwrite(fd, &val, sizeof(val), (off_t)addr) == sizeof(val) ? 0 : -1;
+}
+
+// reset values of a single eCore, all other regs and its SRAM stay zero
+static int eEmuCore(int fd, eCoreMemMap_t *eCore)
+{
+  eCoreRegs_t *regs = &eCore->regs;
+  int ret = eEmuPoke(fd, (uintptr_t)&regs->coreid.reg,
+                     (ECORE_ADDR_ROWID(eCore) << 6) | ECORE_ADDR_COLID(eCore));
+  ret |= eEmuPoke(fd, (uintptr_t)&regs->status.reg, 0);      // idle
+  ret |= eEmuPoke(fd, (uintptr_t)&regs->debugstatus.reg, 0); // running, nothing pending
+  for(unsigned i = 0; i < elemsof(regs->dma); ++i)
+    ret |= eEmuPoke(fd, (uintptr_t)&regs->dma[i].status.reg, 0); // DMA idle
+  return ret;
+}
+
+int eEmuOpen(eConfig_t *cfg)
+{
+  assert( cfg );
+
+  int fd = memfd_create("ehal-emulate", MFD_CLOEXEC);
+  if(fd == -1) {
+    eCoresError("Could not create emulated EPIPHANY (errno %d, %s)!\n", errno, strerror(errno));
+    return -1;
+  }
+
+  // sparse, solely touched pages get backed
+  eConfigChip_t *chip = cfg->lchip;
+  uintptr_t end = EMU_END;
+  if(end < (uintptr_t)&chip->eCoreRoot[chip->xyDim][0])
+    end = (uintptr_t)&chip->eCoreRoot[chip->xyDim][0];
+  if(end < cfg->lemem->base_address + cfg->lemem->size)
+    end = cfg->lemem->base_address + cfg->lemem->size;
+  if(ftruncate(fd, (off_t)end)) {
+    eCoresError("Could not size emulated EPIPHANY to %s (errno %d, %s)!\n", fmtBytes((unsigned)end), errno, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  // esysinfo has to identify the very same chip as the HDF
+  int ret = eEmuPoke(fd, (uintptr_t)&cfg->esys_regs_base->esysinfo.reg,
+                     (1 << 16) /* revision */
+                     | (2 << 8) /* headless */
+                     | (chip->type == E64G401 ? 5 : 1) /* platform */);
+  ret |= eEmuPoke(fd, SLCR_PSS_IDCODE, EMU_ZYNQ_IDCODE);
+  ret |= eEmuPoke(fd, DEVCFG_MCTRL, EMU_ZYNQ_MCTRL);
+  for(unsigned r = 0; r < chip->xyDim; ++r)
+    for(unsigned c = 0; c < chip->xyDim; ++c)
+      ret |= eEmuCore(fd, &chip->eCoreRoot[r][c]);
+  if(ret) {
+    eCoresError("Could not initialise emulated EPIPHANY registers (errno %d, %s)!\n", errno, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  // no root, hence the mmaps are mostly beyond RLIMIT_MEMLOCK
+  eMmapLocked(0);
+
+  cfg->fd = fd;
+  cfg->emulated = 1;
+  eCoresPrintf(E_DBG, "Emulating EPIPHANY by memfd (%s sparse)\n", fmtBytes((unsigned)end));
+  return 0;
+}
@@ -1,15 +1,31 @@
 // SPDX-License-Identifier: BSD-2-Clause
 // SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
 
+#define _GNU_SOURCE /* MAP_HUGETLB, MAP_HUGE_SHIFT, MADV_HUGEPAGE */
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/mman.h>
 #include <asm-generic/mman.h> /* MAP_LOCKED */
 #include "ehal-mmap.h"
 #include "ehal-print.h"
 
+#define HUGEPAGE_2MB  0x200000
+
+// An emulated EPIPHANY runs without root, hence mostly within RLIMIT_MEMLOCK
+static int emmapLocked = MAP_LOCKED;
+
+void eMmapLocked(int locked)
+{
+  emmapLocked = locked ? MAP_LOCKED : 0;
+}
+#if defined(MAP_HUGE_SHIFT) && !defined(MAP_HUGE_2MB)
+#define MAP_HUGE_2MB  (21 << MAP_HUGE_SHIFT)
+#endif
+
 int _eCoreMmap(int fd, eCoreMemMap_t* eCoreCur, eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd)
 {
   assert( fd >= 0 );
@@ -21,23 +37,31 @@ int _eCoreMmap(int fd, eCoreMemMap_t* eCoreCur, eCoreMemMap_t* eCoreBgn, eCoreMe
      || ECORE_ADDR_ROWID(eCoreCur) > ECORE_ADDR_ROWID(eCoreEnd))
     return 0;
 
-  int flags = MAP_LOCKED;
+  // MAP_SHARED_VALIDATE rejects MAP_FIXED_NOREPLACE (EOPNOTSUPP), as it is
+  // not part of the legacy flags the kernel validates.
+  int flags = emmapLocked;
 #ifdef MAP_FIXED_NOREPLACE
-  flags |= MAP_FIXED_NOREPLACE;
+  flags |= MAP_FIXED_NOREPLACE | MAP_SHARED;
 #else
   flags |= MAP_FIXED;
-#endif
 #ifdef MAP_SHARED_VALIDATE
   flags |= MAP_SHARED_VALIDATE;
 #else
   flags |= MAP_SHARED;
-#endif    
+#endif
+#endif
   void *esram = mmap((char*)&eCoreCur->sram[0], sizeof(eCoreCur->sram), PROT_READ|PROT_WRITE, flags, fd, (off_t)&eCoreCur->sram[0]);
   assert(esram == eCoreCur->sram);
   if(esram != MAP_FAILED) {
     eCorePrintf(E_DBG, eCoreCur, "VA %p, PA %p (%7s) - eCore sram\n", eCoreCur->sram, eCoreCur->sram, fmtBytes(sizeof(eCoreCur->sram)) );
 
-    void *eregs = mmap(&eCoreCur->regs, sizeof(eCoreCur->regs), PROT_READ|PROT_WRITE, flags, fd, (off_t)&eCoreCur->regs);
+    // The regs page of the root eCore is the very same as of the FPGA regs
+    // (eSysRegsMmap), which is mapped already. Hence may replace.
+    int rflags = flags;
+#ifdef MAP_FIXED_NOREPLACE
+    rflags = (rflags & ~MAP_FIXED_NOREPLACE) | MAP_FIXED;
+#endif
+    void *eregs = mmap(&eCoreCur->regs, sizeof(eCoreCur->regs), PROT_READ|PROT_WRITE, rflags, fd, (off_t)&eCoreCur->regs);
     assert(eregs == &eCoreCur->regs);
     if(eregs != MAP_FAILED) {
       eCorePrintf(E_DBG, eCoreCur, "VA %p, PA %p (%7s) - eCore regs\n", &eCoreCur->regs, &eCoreCur->regs, fmtBytes(sizeof(eCoreCur->regs)) );
@@ -99,50 +123,121 @@ int eCoreMunmap(eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCoreEnd)
 }
 
 
+// https://www.kernel.org/doc/html/latest/admin-guide/mm/hugetlbpage.html
+// Solely try MAP_HUGETLB if the kernel has 2MB pages reserved and free.
+static int eHugetlbAvailable(void)
+{
+  unsigned long free = 0;
+  FILE *f = fopen("/sys/kernel/mm/hugepages/hugepages-2048kB/free_hugepages", "r");
+  if(f) {
+    if(fscanf(f, "%lu", &free) != 1)
+      free = 0;
+    fclose(f);
+  }
+  return free > 0;
+}
+
+// https://www.kernel.org/doc/html/latest/admin-guide/mm/transhuge.html
+// MADV_HUGEPAGE is solely of use if THP is set to "always" or "madvise".
+static int eThpAvailable(void)
+{
+  char mode[64] = "";
+  FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if(f) {
+    if(!fgets(mode, sizeof(mode), f))
+      mode[0] = '\0';
+    fclose(f);
+  }
+  return !strstr(mode, "[never]") && (strstr(mode, "[always]") || strstr(mode, "[madvise]"));
+}
+
+// Page size the kernel actually backs the mapping with (smaps of the VMA)
+static uint32_t eMmapPageSize(void *addr)
+{
+  uint32_t pagesize = 0x1000;
+  FILE *f = fopen("/proc/self/smaps", "r");
+  if(!f)
+    return pagesize;
+
+  char line[256];
+  int inVma = 0;
+  while(fgets(line, sizeof(line), f)) {
+    unsigned long bgn, end, kb;
+    if(sscanf(line, "%lx-%lx ", &bgn, &end) == 2) {
+      if(inVma)
+        break;
+      inVma = (bgn == (uintptr_t)addr);
+    }
+    else if(inVma) {
+      if(sscanf(line, "KernelPageSize: %lu kB", &kb) == 1
+         && (kb << 10) > pagesize)
+        pagesize = kb << 10;
+      else if((sscanf(line, "AnonHugePages: %lu kB", &kb) == 1
+               || sscanf(line, "FilePmdMapped: %lu kB", &kb) == 1)
+              && kb)
+        pagesize = HUGEPAGE_2MB;
+    }
+  }
+  fclose(f);
+  return pagesize;
+}
+
 int eShmMmap(int fd, __typeof__(&((eConfig_t*)0x0)->emem[0]) emem)
 {
   assert( fd >= 0 );
   assert( emem );
 
   // Can not use MAP_FIXED_NOREPLACE as it would 'normally' overlap with eCore mmap
-  int flags = MAP_FIXED | MAP_LOCKED;
+  int flags = MAP_FIXED | emmapLocked;
 #ifdef MAP_SHARED_VALIDATE
   flags |= MAP_SHARED_VALIDATE;
 #else
   flags |= MAP_SHARED;
 #endif
 
-// https://www.kernel.org/doc/html/latest/admin-guide/mm/hugetlbpage.html
-#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB) // ToDo: check if working
-  if(emem->size >= 0x200000 /* 2MB */
-     && !(emem->size % 0x200000)) {
-    flags |= MAP_HUGETLB | MAP_HUGE_2MB;
-    printf("will try hugetlb!\n");
+  // solely the leased range for clients of a broker
+  char *base = emem->epi_base + emem->map_offset;
+  off_t phys = emem->base_address + emem->map_offset;
+  void* eshm = MAP_FAILED;
+  int huge = !((emem->map_offset | emem->map_size) % HUGEPAGE_2MB);
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+  if(huge && eHugetlbAvailable()) {
+    eshm = mmap(base, emem->map_size, emem->prot, flags | MAP_HUGETLB | MAP_HUGE_2MB, fd, phys);
+    if(eshm == MAP_FAILED)
+      eCoresPrintf(E_DBG, "Zynq <-> eCores shm: MAP_HUGETLB failed (%s), retry with 4K pages\n", strerror(errno));
   }
 #endif
-  void* eshm = mmap(emem->epi_base, emem->size, emem->prot, flags, fd, emem->base_address);
-  assert(eshm == emem->epi_base);
+  if(eshm == MAP_FAILED)
+    eshm = mmap(base, emem->map_size, emem->prot, flags, fd, phys);
+  assert(eshm == base);
   if(eshm == MAP_FAILED) {
-    eCoresError("failed on mmap eshm %p (errno %d, %s)! Cleaning up...\n", emem->epi_base, errno, strerror(errno));
+    eCoresError("failed on mmap eshm %p (errno %d, %s)! Cleaning up...\n", base, errno, strerror(errno));
     return -1;
   }
-  
-// In case MAP_HUGETLB is not defined, let us try the 2nd option:
+
+  emem->pagesize = eMmapPageSize(eshm);
+
+// In case MAP_HUGETLB did not work out, let us try the 2nd option:
 // Quote:      "It is mostly intended for
 //              embedded systems, where MADV_HUGEPAGE-style behavior may
 //              not be enabled by default in the kernel."
 // https://man7.org/linux/man-pages/man2/madvise.2.html
 // Do not care about return value, as it is just hint to Linux
-#if ! (defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)) && defined(MADV_HUGEPAGE)
-  int madvHugepage = madvise(eshm, emem->size, MADV_HUGEPAGE);
-  eCoresPrintf(E_DBG, "Zynq <-> eCores shm: madvise(MADV_HUGEPAGE): %d%s%s%s\n",
-               madvHugepage,
-               madvHugepage ? " (" : "",
-               madvHugepage ? strerror(errno) : "",
-               madvHugepage ? ")" : "" );
+#if defined(MADV_HUGEPAGE)
+  if(huge && emem->pagesize < HUGEPAGE_2MB && eThpAvailable()) {
+    int madvHugepage = madvise(eshm, emem->map_size, MADV_HUGEPAGE);
+    eCoresPrintf(E_DBG, "Zynq <-> eCores shm: madvise(MADV_HUGEPAGE): %d%s%s%s\n",
+                 madvHugepage,
+                 madvHugepage ? " (" : "",
+                 madvHugepage ? strerror(errno) : "",
+                 madvHugepage ? ")" : "" );
+    if(!madvHugepage)
+      emem->pagesize = eMmapPageSize(eshm);
+  }
 #endif
-  
-  eCorePrintf(E_DBG, eshm, "VA %p, PA %p (%7s) - Zynq <-> eCores shm\n", eshm, (void*)emem->base_address, fmtBytes(emem->size) );
+
+  eCorePrintf(E_DBG, eshm, "VA %p, PA %p (%7s) - Zynq <-> eCores shm\n", eshm, (void*)phys, fmtBytes((unsigned)emem->map_size) );
+  eCorePrintf(E_INF, eshm, "Zynq <-> eCores shm backed by %s pages\n", fmtBytes((unsigned)emem->pagesize) );
 
   return 0;
 }
@@ -151,7 +246,179 @@ int eShmMunmap(__typeof__(&((eConfig_t*)0x0)->emem[0]) emem)
 {
   assert( emem );
 
-  return munmap(emem->epi_base, emem->size);
+  return munmap(emem->epi_base + emem->map_offset, emem->map_size);
+}
+
+
+// Whether the O_SYNC mapping of [pa, pa+size) by dev is write-combined.
+// Solely /dev/mem on arm64 maps so, and solely RAM the kernel knows (System
+// RAM in /proc/iomem), anything else is non-cacheable resp. up to the driver.
+// Without CAP_SYS_ADMIN /proc/iomem reads as 0, i.e. not write-combined.
+static int eShmWriteCombined(const char *dev, uint64_t pa, size_t size)
+{
+#if defined(__aarch64__)
+  if(strcmp(dev, "/dev/mem"))
+    return 0;
+  FILE *iomem = fopen("/proc/iomem", "r");
+  if(!iomem)
+    return 0;
+  char line[128];
+  int wc = 0;
+  while(!wc && fgets(line, sizeof(line), iomem)) {
+    unsigned long long bgn, end;
+    int n = 0;
+    if(line[0] != ' '                   // top level, not nested resources
+       && sscanf(line, "%llx-%llx : System RAM%n", &bgn, &end, &n) == 2 && n
+       && bgn <= pa && pa + size - 1 <= end)
+      wc = 1;
+  }
+  fclose(iomem);
+  return wc;
+#else
+  (void)dev;
+  (void)pa;
+  (void)size;
+  return 0;
+#endif
+}
+
+// The device fd is opened with O_SYNC, hence the eMem is mapped uncached.
+// Reopening it via /proc/self/fd gives a new open file description, which
+// allows to decide for O_SYNC anew (also works on an fd from the broker).
+// /dev/mem on ARM (phys_mem_access_prot) maps kernel known RAM:
+//   without O_SYNC -> cacheable
+//   with O_SYNC    -> write-combine
+// and anything else non-cacheable. Other drivers decide on their own.
+// On the Parallella the eMem (0x3e000000) lies beyond the kernel's RAM, so
+// /dev/mem maps it strongly ordered whatever the flags. Even a cacheable
+// mapping could not be kept coherent, ARMv7 user space has no clean resp.
+// invalidate by VA (cacheflush solely cleans to the PoU, never the PL310).
+// Hence refused on ARMv7 until a driver provides both.
+int eShmCachedMmap(int fd, __typeof__(&((eConfig_t*)0x0)->emem[0]) emem, int mode)
+{
+  assert( fd >= 0 );
+  assert( emem );
+
+#if defined(__arm__)
+  eCoresError("no %s eMem aperture on ARMv7, no cache maintenance incl. the L2 by VA!\n",
+              mode == ESHM_WRITECOMBINE ? "write-combined" : "cached");
+  return -1;
+#endif
+
+  if(emem->cached_base) {
+    if(emem->cached_mode == mode)
+      return 0;
+    eShmCachedMunmap(emem);
+  }
+
+  char path[32];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+  int cfd = open(path, O_RDWR | O_CLOEXEC | (mode == ESHM_WRITECOMBINE ? O_SYNC : 0));
+  if(cfd == -1) {
+    eCoresError("failed on reopen of %s (errno %d, %s)!\n", path, errno, strerror(errno));
+    return -1;
+  }
+
+  char dev[64] = "";
+  ssize_t devlen = readlink(path, dev, sizeof(dev) - 1);
+  if(devlen > 0)
+    dev[devlen] = '\0';
+  void* eshm = mmap(NULL, emem->map_size, emem->prot, MAP_SHARED, cfd, emem->base_address + emem->map_offset);
+  close(cfd); // mapping keeps the reference
+  if(eshm == MAP_FAILED) {
+    eCoresError("failed on mmap of %s eshm (errno %d, %s)!\n",
+                mode == ESHM_WRITECOMBINE ? "write-combined" : "cached", errno, strerror(errno));
+    return -1;
+  }
+
+  // cached_base corresponds to epi_base, even if solely the lease is mapped
+  emem->cached_base = (char*)eshm - emem->map_offset;
+  emem->cached_mode = mode;
+  emem->cached_wc = mode == ESHM_WRITECOMBINE
+                    && eShmWriteCombined(dev, emem->base_address + emem->map_offset, emem->map_size);
+  if(mode == ESHM_WRITECOMBINE && !emem->cached_wc)
+    eCoresWarn("%s maps eMem not known to be write-combined, stores stay direct\n", dev);
+  eCorePrintf(E_DBG, emem->epi_base, "VA %p, PA %p (%7s) - Zynq <-> eCores shm (%s)\n",
+              eshm, (void*)(emem->base_address + emem->map_offset), fmtBytes((unsigned)emem->map_size),
+              mode == ESHM_WRITECOMBINE ? "write-combined" : "cached");
+  return 0;
+}
+
+int eShmCachedMunmap(__typeof__(&((eConfig_t*)0x0)->emem[0]) emem)
+{
+  assert( emem );
+
+  if(!emem->cached_base)
+    return 0;
+
+  int ret = munmap(emem->cached_base + emem->map_offset, emem->map_size);
+  emem->cached_base = NULL;
+  emem->cached_mode = 0;
+  emem->cached_wc = 0;
+  return ret;
+}
+
+// Write back the cache lines of [addr, addr+size) to memory.
+// Used before the eCores read what the host wrote via a cached aperture.
+void eShmCacheClean(const void *addr, size_t size)
+{
+  if(!size)
+    return;
+
+#if defined(__aarch64__)
+  uint64_t ctr;
+  __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+  uintptr_t line = 4 << ((ctr >> 16) & 0xF);
+  uintptr_t p = (uintptr_t)addr & ~(line - 1), end = (uintptr_t)addr + size;
+  for( ; p < end; p += line)
+    __asm__ volatile("dc cvac, %0" :: "r"(p) : "memory");
+  __asm__ volatile("dsb sy" ::: "memory");
+#elif defined(__arm__)
+  // no cached aperture, see eShmCachedMmap(), solely drain the stores
+  __asm__ volatile("dsb" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+  uintptr_t line = 64;
+  uintptr_t p = (uintptr_t)addr & ~(line - 1), end = (uintptr_t)addr + size;
+  __builtin_ia32_mfence();
+  for( ; p < end; p += line)
+    __builtin_ia32_clflush((void*)p);
+  __builtin_ia32_mfence();
+#else
+  __sync_synchronize();
+#endif
+}
+
+// Drop the cache lines of [addr, addr+size), the next reads fetch memory.
+// Used before the host reads what the eCores wrote. EL0 has no invalidate
+// solely, dirty lines get written back first, hence the host must not have
+// written the range meanwhile.
+void eShmCacheInvalidate(const void *addr, size_t size)
+{
+  if(!size)
+    return;
+
+#if defined(__aarch64__)
+  uint64_t ctr;
+  __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+  uintptr_t line = 4 << ((ctr >> 16) & 0xF);
+  uintptr_t p = (uintptr_t)addr & ~(line - 1), end = (uintptr_t)addr + size;
+  __asm__ volatile("dsb sy" ::: "memory");
+  for( ; p < end; p += line)
+    __asm__ volatile("dc civac, %0" :: "r"(p) : "memory");
+  __asm__ volatile("dsb sy" ::: "memory");
+#elif defined(__arm__)
+  // no cached aperture, see eShmCachedMmap(), solely order the loads
+  __asm__ volatile("dsb" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+  uintptr_t line = 64;
+  uintptr_t p = (uintptr_t)addr & ~(line - 1), end = (uintptr_t)addr + size;
+  __builtin_ia32_mfence();
+  for( ; p < end; p += line)
+    __builtin_ia32_clflush((void*)p);
+  __builtin_ia32_mfence();
+#else
+  __sync_synchronize();
+#endif
 }
 
 
@@ -161,7 +428,7 @@ int eSysRegsMmap(int fd, eSysRegs* esys_regs_base)
   assert( esys_regs_base );
 
   // Can not use MAP_FIXED_NOREPLACE as it would 'normally' overlap with eCore mmap
-  int flags = MAP_FIXED | MAP_LOCKED;
+  int flags = MAP_FIXED | emmapLocked;
 #ifdef MAP_SHARED_VALIDATE
   flags |= MAP_SHARED_VALIDATE;
 #else
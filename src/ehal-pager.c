@@ -0,0 +1,475 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* pread, pwrite */
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ehal.h"
+#include "ehal-pager.h"
+#include "ehal-print.h"
+
+#define EPAGER_QUEUE        64
+
+typedef enum {
+  EPAGE_EMPTY = 0,
+  EPAGE_LOADING,                    // writeback of the old and fetch of the new page
+  EPAGE_READY,
+  EPAGE_WRITEBACK                   // ePagerFlush(), still readable
+} ePageState_t;
+
+typedef struct {
+  uint64_t page;
+  uint32_t pins;
+  uint8_t state;
+  uint8_t dirty;
+} ePagerSlot_t;
+
+struct ePager_s {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;              // slot state changes, prefetch requests
+
+  ePagerSource_t src;
+  ePagerPolicy_t policy;
+  void *pstate;
+
+  uint64_t size, pages;
+  uint32_t pageSize;
+  unsigned slots;
+  unsigned readahead;
+  eMemPtr_t mem;
+  ePagerSlot_t *slot;
+  uint8_t *evictable;               // scratch for the policy
+
+  uint64_t queue[EPAGER_QUEUE];     // prefetch requests
+  unsigned qhead, qcount;
+  pthread_t thread;
+  int threadUp, stop;
+
+  ePagerStats_t stats;
+};
+
+
+// ---- sources ----
+
+static int ePagerMemFetch(void *ctx, uint64_t page, uint64_t offset, void *dst, uint32_t size)
+{
+  (void)page;
+  memcpy(dst, (char*)ctx + offset, size);
+  return 0;
+}
+
+static int ePagerMemWriteback(void *ctx, uint64_t page, uint64_t offset, const void *src, uint32_t size)
+{
+  (void)page;
+  memcpy((char*)ctx + offset, src, size);
+  return 0;
+}
+
+ePagerSource_t ePagerSourceMem(void *base)
+{
+  return (ePagerSource_t){ .fetch = ePagerMemFetch, .writeback = ePagerMemWriteback, .ctx = base };
+}
+
+static int ePagerFdFetch(void *ctx, uint64_t page, uint64_t offset, void *dst, uint32_t size)
+{
+  (void)page;
+  int fd = (int)(intptr_t)ctx;
+  for(uint32_t done = 0; done < size; ) {
+    ssize_t r = pread(fd, (char*)dst + done, size - done, (off_t)(offset + done));
+    if(r < 0 && errno == EINTR)
+      continue;
+    if(r < 0)
+      return -1;
+    if(!r) { // beyond EOF
+      memset((char*)dst + done, 0, size - done);
+      break;
+    }
+    done += r;
+  }
+  return 0;
+}
+
+static int ePagerFdWriteback(void *ctx, uint64_t page, uint64_t offset, const void *src, uint32_t size)
+{
+  (void)page;
+  int fd = (int)(intptr_t)ctx;
+  for(uint32_t done = 0; done < size; ) {
+    ssize_t w = pwrite(fd, (const char*)src + done, size - done, (off_t)(offset + done));
+    if(w < 0 && errno == EINTR)
+      continue;
+    if(w <= 0)
+      return -1;
+    done += w;
+  }
+  return 0;
+}
+
+ePagerSource_t ePagerSourceFd(int fd)
+{
+  return (ePagerSource_t){ .fetch = ePagerFdFetch, .writeback = ePagerFdWriteback, .ctx = (void*)(intptr_t)fd };
+}
+
+
+// ---- policies ----
+
+typedef struct {
+  uint64_t clock;
+  uint64_t stamp[];
+} ePagerStamps_t;
+
+static void* ePagerStampsInit(unsigned slots)
+{
+  return calloc(1, sizeof(ePagerStamps_t) + slots * sizeof(uint64_t));
+}
+
+static void ePagerStampsFini(void *state)
+{
+  free(state);
+}
+
+static void ePagerStampsSet(void *state, unsigned slot)
+{
+  ePagerStamps_t *s = state;
+  s->stamp[slot] = ++s->clock;
+}
+
+static void ePagerStampsKeep(void *state, unsigned slot)
+{
+  (void)state;
+  (void)slot;
+}
+
+// oldest stamp
+static int ePagerStampsVictim(void *state, unsigned slots, const uint8_t *evictable)
+{
+  ePagerStamps_t *s = state;
+  int victim = -1;
+  for(unsigned i = 0; i < slots; ++i)
+    if(evictable[i] && (victim < 0 || s->stamp[i] < s->stamp[victim]))
+      victim = i;
+  return victim;
+}
+
+const ePagerPolicy_t ePagerLru = {
+  .init = ePagerStampsInit, .fini = ePagerStampsFini,
+  .insert = ePagerStampsSet, .touch = ePagerStampsSet,
+  .victim = ePagerStampsVictim
+};
+
+const ePagerPolicy_t ePagerFifo = {
+  .init = ePagerStampsInit, .fini = ePagerStampsFini,
+  .insert = ePagerStampsSet, .touch = ePagerStampsKeep,
+  .victim = ePagerStampsVictim
+};
+
+
+// ---- pager ----
+
+inline static char* ePagerSlotHost(ePager_t *pager, unsigned s)
+{
+  return (char*)pager->mem.host + (size_t)s * pager->pageSize;
+}
+
+inline static uint32_t ePagerPageSize(ePager_t *pager, uint64_t page)
+{
+  uint64_t rest = pager->size - page * pager->pageSize;
+  return rest < pager->pageSize ? (uint32_t)rest : pager->pageSize;
+}
+
+// lock held
+static int ePagerFind(ePager_t *pager, uint64_t page)
+{
+  for(unsigned s = 0; s < pager->slots; ++s)
+    if(pager->slot[s].state != EPAGE_EMPTY && pager->slot[s].page == page)
+      return s;
+  return -1;
+}
+
+// lock held, drops it during I/O; returns the READY and unpinned slot,
+// -1 if none is evictable resp. -2 on a failed writeback or fetch
+static int ePagerLoad(ePager_t *pager, uint64_t page)
+{
+  int s;
+  for(s = 0; s < (int)pager->slots && pager->slot[s].state != EPAGE_EMPTY; ++s);
+  if(s == (int)pager->slots) {
+    for(unsigned i = 0; i < pager->slots; ++i)
+      pager->evictable[i] = pager->slot[i].state == EPAGE_READY && !pager->slot[i].pins;
+    if((s = pager->policy.victim(pager->pstate, pager->slots, pager->evictable)) < 0)
+      return -1;
+    assert( pager->evictable[s] );
+    ++pager->stats.evictions;
+  }
+
+  ePagerSlot_t *slot = &pager->slot[s];
+  uint64_t old = slot->page;
+  int dirty = slot->state == EPAGE_READY && slot->dirty && pager->src.writeback;
+  slot->page = page;
+  slot->state = EPAGE_LOADING;
+  slot->dirty = 0;
+  pthread_mutex_unlock(&pager->lock);
+
+  char *host = ePagerSlotHost(pager, s);
+  if(dirty
+     && pager->src.writeback(pager->src.ctx, old, old * pager->pageSize, host, ePagerPageSize(pager, old))) {
+    // the sole copy of the changes, keep the old page instead
+    pthread_mutex_lock(&pager->lock);
+    slot->page = old;
+    slot->state = EPAGE_READY;
+    slot->dirty = 1;
+    --pager->stats.evictions;
+    pthread_cond_broadcast(&pager->cond);
+    eCoresError("Pager: could not write back page %llu!\n", (unsigned long long)old);
+    return -2;
+  }
+  int ret = pager->src.fetch(pager->src.ctx, page, page * pager->pageSize, host, ePagerPageSize(pager, page));
+
+  pthread_mutex_lock(&pager->lock);
+  pager->stats.writebacks += dirty;
+  slot->state = ret ? EPAGE_EMPTY : EPAGE_READY;
+  if(!ret)
+    pager->policy.insert(pager->pstate, s);
+  pthread_cond_broadcast(&pager->cond);
+  if(ret) {
+    eCoresError("Pager: could not fetch page %llu!\n", (unsigned long long)page);
+    return -2;
+  }
+  return s;
+}
+
+// lock held
+static void ePagerEnqueue(ePager_t *pager, uint64_t page)
+{
+  if(!pager->threadUp || page >= pager->pages || pager->qcount == EPAGER_QUEUE
+     || ePagerFind(pager, page) >= 0)
+    return;
+  for(unsigned i = 0; i < pager->qcount; ++i)
+    if(pager->queue[(pager->qhead + i) % EPAGER_QUEUE] == page)
+      return;
+  pager->queue[(pager->qhead + pager->qcount++) % EPAGER_QUEUE] = page;
+  pthread_cond_broadcast(&pager->cond);
+}
+
+static void* ePagerThread(void *arg)
+{
+  ePager_t *pager = arg;
+  pthread_mutex_lock(&pager->lock);
+  while(!pager->stop) {
+    if(!pager->qcount) {
+      pthread_cond_wait(&pager->cond, &pager->lock);
+      continue;
+    }
+    uint64_t page = pager->queue[pager->qhead];
+    pager->qhead = (pager->qhead + 1) % EPAGER_QUEUE;
+    --pager->qcount;
+    // no slot to spare is fine, prefetching is a hint
+    if(ePagerFind(pager, page) < 0 && ePagerLoad(pager, page) >= 0)
+      ++pager->stats.prefetched;
+  }
+  pthread_mutex_unlock(&pager->lock);
+  return NULL;
+}
+
+ePager_t* ePagerCreate(const ePagerSource_t *src, uint64_t size,
+                       uint32_t pageSize, unsigned slots, unsigned readahead,
+                       const ePagerPolicy_t *policy)
+{
+  assert( src && src->fetch );
+  assert( policy );
+
+  if(!size) {
+    eCoresError("Pager: dataset is empty!\n");
+    return NULL;
+  }
+  if(!slots) {
+    eCoresError("Pager: needs at least one slot!\n");
+    return NULL;
+  }
+  if(!pageSize || (pageSize & 63)) {
+    eCoresError("Pager: page size has to be a non-zero multiple of 64 bytes!\n");
+    return NULL;
+  }
+
+  ePager_t *pager = calloc(1, sizeof(*pager));
+  if(pager) {
+    pager->src = *src;
+    pager->policy = *policy;
+    pager->size = size;
+    pager->pageSize = pageSize;
+    pager->pages = (size + pageSize - 1) / pageSize;
+    pager->slots = slots;
+    pager->readahead = readahead;
+    pager->slot = calloc(slots, sizeof(pager->slot[0]));
+    pager->evictable = calloc(slots, sizeof(pager->evictable[0]));
+    pager->pstate = policy->init(slots);
+    if(pager->slot && pager->evictable && pager->pstate) {
+      pager->mem = eMemAlloc((size_t)slots * pageSize);
+      if(pager->mem.host) {
+        if(!pthread_mutex_init(&pager->lock, NULL)) {
+          if(!pthread_cond_init(&pager->cond, NULL)) {
+            // without the thread there is solely no prefetching
+            pager->threadUp = readahead && !pthread_create(&pager->thread, NULL, ePagerThread, pager);
+            eCoresPrintf(E_DBG, "Pager: %llu pages of %s through %u slots\n",
+                         (unsigned long long)pager->pages, fmtBytes(pageSize), slots);
+            return pager;
+          }
+          pthread_mutex_destroy(&pager->lock);
+        }
+        eMemFree(pager->mem.host);
+      }
+      else
+        eCoresError("Pager: could not allocate %u slots of %s in eMem!\n", slots, fmtBytes(pageSize));
+    }
+    if(pager->pstate)
+      policy->fini(pager->pstate);
+    free(pager->evictable);
+    free(pager->slot);
+    free(pager);
+  }
+  return NULL;
+}
+
+void ePagerDestroy(ePager_t *pager)
+{
+  if(!pager)
+    return;
+
+  if(pager->threadUp) {
+    pthread_mutex_lock(&pager->lock);
+    pager->stop = 1;
+    pthread_cond_broadcast(&pager->cond);
+    pthread_mutex_unlock(&pager->lock);
+    pthread_join(pager->thread, NULL);
+  }
+  ePagerFlush(pager);
+
+  pthread_cond_destroy(&pager->cond);
+  pthread_mutex_destroy(&pager->lock);
+  eMemFree(pager->mem.host);
+  pager->policy.fini(pager->pstate);
+  free(pager->evictable);
+  free(pager->slot);
+  free(pager);
+}
+
+int ePagerAcquire(ePager_t *pager, uint64_t page, eMemPtr_t *p)
+{
+  assert( pager );
+  assert( p );
+
+  if(page >= pager->pages)
+    return -1;
+
+  pthread_mutex_lock(&pager->lock);
+  int s;
+  for(;;) {
+    if((s = ePagerFind(pager, page)) >= 0) {
+      if(pager->slot[s].state == EPAGE_LOADING) {
+        pthread_cond_wait(&pager->cond, &pager->lock);
+        continue;
+      }
+      ++pager->stats.hits;
+      break;
+    }
+    if((s = ePagerLoad(pager, page)) >= 0) {
+      ++pager->stats.misses;
+      break;
+    }
+    if(s < -1) {
+      pthread_mutex_unlock(&pager->lock);
+      return -1;
+    }
+    // all slots pinned, wait if some get loaded resp. released
+    unsigned busy = 0;
+    for(unsigned i = 0; i < pager->slots; ++i)
+      busy += pager->slot[i].state == EPAGE_LOADING || pager->slot[i].state == EPAGE_WRITEBACK;
+    if(!busy) {
+      pthread_mutex_unlock(&pager->lock);
+      eCoresError("Pager: all %u slots are pinned!\n", pager->slots);
+      return -1;
+    }
+    pthread_cond_wait(&pager->cond, &pager->lock);
+  }
+  ++pager->slot[s].pins;
+  pager->policy.touch(pager->pstate, s);
+
+  for(unsigned i = 1; i <= pager->readahead; ++i)
+    ePagerEnqueue(pager, page + i);
+  pthread_mutex_unlock(&pager->lock);
+
+  p->host = ePagerSlotHost(pager, s);
+  p->eaddr = pager->mem.eaddr + (uint32_t)s * pager->pageSize;
+  return 0;
+}
+
+void ePagerRelease(ePager_t *pager, uint64_t page, int dirty)
+{
+  assert( pager );
+
+  pthread_mutex_lock(&pager->lock);
+  int s = ePagerFind(pager, page);
+  assert( s >= 0 && pager->slot[s].pins );
+  if(s >= 0 && pager->slot[s].pins) {
+    --pager->slot[s].pins;
+    pager->slot[s].dirty |= !!dirty;
+    pthread_cond_broadcast(&pager->cond);
+  }
+  pthread_mutex_unlock(&pager->lock);
+}
+
+void ePagerPrefetch(ePager_t *pager, uint64_t page)
+{
+  assert( pager );
+
+  pthread_mutex_lock(&pager->lock);
+  ePagerEnqueue(pager, page);
+  pthread_mutex_unlock(&pager->lock);
+}
+
+int ePagerFlush(ePager_t *pager)
+{
+  assert( pager );
+
+  if(!pager->src.writeback)
+    return 0;
+
+  int ret = 0;
+  pthread_mutex_lock(&pager->lock);
+  for(unsigned s = 0; s < pager->slots; ++s) {
+    ePagerSlot_t *slot = &pager->slot[s];
+    if(slot->state != EPAGE_READY || !slot->dirty)
+      continue;
+    slot->state = EPAGE_WRITEBACK;
+    slot->dirty = 0;
+    pthread_mutex_unlock(&pager->lock);
+    int r = pager->src.writeback(pager->src.ctx, slot->page, slot->page * pager->pageSize,
+                                 ePagerSlotHost(pager, s), ePagerPageSize(pager, slot->page));
+    pthread_mutex_lock(&pager->lock);
+    slot->state = EPAGE_READY;
+    slot->dirty |= !!r;
+    ret |= r;
+    ++pager->stats.writebacks;
+    pthread_cond_broadcast(&pager->cond);
+  }
+  pthread_mutex_unlock(&pager->lock);
+  return ret ? -1 : 0;
+}
+
+uint64_t ePagerPages(const ePager_t *pager)
+{
+  assert( pager );
+  return pager->pages;
+}
+
+void ePagerGetStats(ePager_t *pager, ePagerStats_t *stats)
+{
+  assert( pager );
+  assert( stats );
+
+  pthread_mutex_lock(&pager->lock);
+  *stats = pager->stats;
+  pthread_mutex_unlock(&pager->lock);
+}
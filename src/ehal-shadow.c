@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "ehal-fence.h"
+#include "ehal-print.h"
+#include "ehal-shadow.h"
+
+typedef enum {
+  ESHADOW_CONFIG = 0,
+  ESHADOW_IMASK,
+  ESHADOW_MESHCONFIG,
+  ESHADOW_DMA0CONFIG,
+  ESHADOW_DMA1CONFIG,
+  ESHADOW_REGS
+} eShadowReg_t;
+
+typedef struct {
+  uint32_t val[ESHADOW_REGS];
+  uint32_t valid;                   // bit per eShadowReg_t
+} eShadow_t;
+
+// rows get allocated on first use, ECORES_MAX_DIM eCores each
+static eShadow_t *eShadowRows[ECORES_MAX_DIM];
+
+
+static int eShadowSlot(volatile void *reg)
+{
+  switch(ECORE_ADDR_LOCAL( reg )) {
+    case offsetof(eCoreMemMap_t, regs.config):        return ESHADOW_CONFIG;
+    case offsetof(eCoreMemMap_t, regs.imask):         return ESHADOW_IMASK;
+    case offsetof(eCoreMemMap_t, regs.meshconfig):    return ESHADOW_MESHCONFIG;
+    case offsetof(eCoreMemMap_t, regs.dma[0].config): return ESHADOW_DMA0CONFIG;
+    case offsetof(eCoreMemMap_t, regs.dma[1].config): return ESHADOW_DMA1CONFIG;
+  }
+  return -1;
+}
+
+static eShadow_t* eShadowOf(const volatile void *addr)
+{
+  unsigned row = ECORE_ADDR_ROWID( addr );
+  eShadow_t *shadows = __atomic_load_n(&eShadowRows[row], __ATOMIC_ACQUIRE);
+  if(!shadows) {
+    eShadow_t *fresh = calloc(ECORES_MAX_DIM, sizeof(*fresh));
+    if(!fresh) {
+      eCoresError("Could not allocate register shadows!\n");
+      return NULL;
+    }
+    if(__atomic_compare_exchange_n(&eShadowRows[row], &shadows, fresh, 0,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      shadows = fresh;
+    else
+      free(fresh);                      // lost against another thread
+  }
+  return &shadows[ECORE_ADDR_COLID( addr )];
+}
+
+// shadowed resp. NULL, *slot set either way
+static eShadow_t* eShadowFind(volatile void *reg, int *slot)
+{
+  *slot = eShadowSlot(reg);
+  return *slot < 0 ? NULL : eShadowOf(reg);
+}
+
+void eRegStore(volatile void *reg, uint32_t val)
+{
+  assert( reg );
+  int slot;
+  eShadow_t *shadow = eShadowFind(reg, &slot);
+  if(shadow) {
+    shadow->val[slot] = val;
+    shadow->valid |= 1u << slot;
+  }
+  eStoreOrdered(reg, val);
+}
+
+uint32_t eRegLoad(volatile void *reg)
+{
+  assert( reg );
+  int slot;
+  eShadow_t *shadow = eShadowFind(reg, &slot);
+  if(!shadow)
+    return *(volatile uint32_t*)reg;
+  if(!(shadow->valid & (1u << slot))) {
+    shadow->val[slot] = *(volatile uint32_t*)reg;
+    shadow->valid |= 1u << slot;
+  }
+  return shadow->val[slot];
+}
+
+void eRegUpdate(volatile void *reg, uint32_t mask, uint32_t bits)
+{
+  eRegStore(reg, (eRegLoad(reg) & ~mask) | (bits & mask));
+}
+
+void eRegForget(volatile void *reg)
+{
+  assert( reg );
+  int slot;
+  eShadow_t *shadow = eShadowFind(reg, &slot);
+  if(shadow)
+    shadow->valid &= ~(1u << slot);
+}
+
+void eRegForgetCore(eCoreMemMap_t *eCore)
+{
+  assert( eCore );
+  eShadow_t *shadow = eShadowOf(eCore);
+  if(shadow)
+    shadow->valid = 0;
+}
+
+void eRegShadowFini(void)
+{
+  for(unsigned row = 0; row < ECORES_MAX_DIM; ++row)
+    free(__atomic_exchange_n(&eShadowRows[row], NULL, __ATOMIC_ACQ_REL));
+}
+
+
+void eRegBatchStore(eRegBatch_t *batch, volatile void *reg, uint32_t val)
+{
+  assert( batch );
+  assert( reg );
+  if(batch->n == batch->max)
+    eRegBatchFlush(batch);
+
+  int slot;
+  eShadow_t *shadow = eShadowFind(reg, &slot);
+  if(shadow) {
+    shadow->val[slot] = val;
+    shadow->valid |= 1u << slot;
+  }
+  batch->w[batch->n++] = (eRegWrite_t){ reg, val };
+}
+
+void eRegBatchUpdate(eRegBatch_t *batch, volatile void *reg, uint32_t mask, uint32_t bits)
+{
+  assert( batch );
+  assert( reg );
+
+  // an unshadowed register is what got queued for it last, else read
+  uint32_t val;
+  if(eShadowSlot(reg) >= 0)
+    val = eRegLoad(reg);
+  else {
+    unsigned i = batch->n;
+    while(i && batch->w[i - 1].reg != reg)
+      --i;
+    val = i ? batch->w[i - 1].val : *(volatile uint32_t*)reg;
+  }
+  eRegBatchStore(batch, reg, (val & ~mask) | (bits & mask));
+}
+
+void eRegBatchFlush(eRegBatch_t *batch)
+{
+  assert( batch );
+
+  // stable by eCore, typically queued in order already
+  for(unsigned i = 1; i < batch->n; ++i) {
+    eRegWrite_t w = batch->w[i];
+    uintptr_t core = (uintptr_t)w.reg & ~ECORE_ADDR_LCLMASK;
+    unsigned j = i;
+    for( ; j && ((uintptr_t)batch->w[j - 1].reg & ~ECORE_ADDR_LCLMASK) > core; --j)
+      batch->w[j] = batch->w[j - 1];
+    batch->w[j] = w;
+  }
+  // after whatever got stored relaxed before, one burst among themselves
+  eFenceStore();
+  for(unsigned i = 0; i < batch->n; ++i)
+    *batch->w[i].reg = batch->w[i].val;
+  eFenceStore();
+  batch->n = 0;
+}
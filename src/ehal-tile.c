@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <string.h>
+#include "ehal-copy.h"
+#include "ehal-dma.h"
+#include "ehal-mmap.h"
+#include "ehal-print.h"
+#include "ehal-shadow.h"
+#include "ehal-tile.h"
+
+#define ETILE_STRIDE_MAX    0x7FFF          // signed 16 bit DMA strides
+
+static int eTileCheck(eConfig_t *cfg, const eTile_t *tile)
+{
+  size_t line = (size_t)tile->tileCols * tile->elem;
+  size_t bytes = line * tile->tileRows;
+  if(!eCoresAreMapped(cfg, tile->row, tile->col, tile->rows, tile->cols)
+     || tile->offset > sizeof(cfg->lchip->eCoreRoot[0][0].sram)
+     || bytes > sizeof(cfg->lchip->eCoreRoot[0][0].sram) - tile->offset
+     || (tile->stride && tile->stride < line * tile->cols)) {
+    eCoresError("tiles %ux%u of %ux%u x %uB at 0x%x exceed the group (%u,%u) %ux%u!\n",
+                tile->tileRows, tile->tileCols, tile->rows, tile->cols, tile->elem,
+                tile->offset, tile->row, tile->col, tile->rows, tile->cols);
+    return -1;
+  }
+  return 0;
+}
+
+// Whether the eCores' DMA engines can move the tiles between SRAM and the
+// matrix in eMem, the 24 byte descriptor must not overlap the tile
+static int eTileDmaable(eConfig_t *cfg, const eTile_t *tile, const void *matrix, size_t stride)
+{
+  eConfigMem_t *emem = cfg->lemem;
+  size_t line = (size_t)tile->tileCols * tile->elem;
+  size_t span = stride * tile->rows * tile->tileRows;
+  uint32_t desc = tile->desc, bytes = line * tile->tileRows;
+  return tile->dma && !cfg->emulated
+         && eShmIsMapped(emem, matrix, span)
+         && !(((uintptr_t)matrix | stride | line | tile->offset | desc) & 7)
+         && (line >> 3) && (line >> 3) <= 0xFFFF && tile->tileRows <= 0xFFFF
+         && stride - line + 8 <= ETILE_STRIDE_MAX
+         && desc <= sizeof(cfg->lchip->eCoreRoot[0][0].sram) - sizeof(eDmaDesc_t)
+         && (desc + sizeof(eDmaDesc_t) <= tile->offset || desc >= tile->offset + bytes);
+}
+
+// Every eCore moves its tile, rows being the outer loop. The matrix side
+// skips to the next row by the outer stride, the SRAM side is packed.
+static int eTileDma(eConfig_t *cfg, const eTile_t *tile, char *matrix, size_t stride, int scatter)
+{
+  size_t line = (size_t)tile->tileCols * tile->elem;
+  int32_t skip = stride - line + 8;
+  unsigned started = 0, total = tile->rows * tile->cols;
+  int ret = 0;
+
+  for(unsigned r = 0; r < tile->rows && !ret; ++r)
+    for(unsigned c = 0; c < tile->cols && !ret; ++c) {
+      eCoreMemMap_t *eCore = &cfg->lchip->eCoreRoot[tile->row + r][tile->col + c];
+      uint32_t sram = (uint32_t)(uintptr_t)&eCore->sram[tile->offset];
+      uint32_t mat = (uint32_t)(uintptr_t)(matrix + r * tile->tileRows * stride + c * line);
+      eDmaDesc_t desc = {
+        .config = EDMA_CONFIG_DWORD,
+        .inner_stride = EDMA_STRIDE( 8, 8 ),
+        .count = (tile->tileRows << 16) | (line >> 3),
+        .outer_stride = scatter ? EDMA_STRIDE( 8, skip ) : EDMA_STRIDE( skip, 8 ),
+        .src_addr = scatter ? mat : sram,
+        .dst_addr = scatter ? sram : mat
+      };
+      eCopy(&eCore->sram[tile->desc], &desc, sizeof(desc));
+      if(eDmaStartDesc(eCore, EDMA_CHANNEL, tile->desc))
+        ret = -1;
+      else
+        ++started;
+    }
+
+  // all eCores run concurrently, wait for the ones started
+  for(unsigned i = 0; i < started; ++i) {
+    eCoreMemMap_t *eCore = &cfg->lchip->eCoreRoot[tile->row + i / tile->cols][tile->col + i % tile->cols];
+    if(eDmaWait(eCore, EDMA_CHANNEL, EDMA_TIMEOUT_US)) {
+      eRegStore(&eCore->regs.dma[EDMA_CHANNEL].config.reg, 0);
+      ret = -1;
+    }
+  }
+  if(ret)
+    eCoresWarn("eCore DMA of %u/%u tiles failed, the host copies\n", total - started, total);
+  return ret;
+}
+
+ssize_t eTileScatter(eConfig_t *cfg, const eTile_t *tile, const void *matrix)
+{
+  assert( cfg );
+  assert( tile );
+  assert( matrix || !tile->rows || !tile->cols );
+
+  if(eTileCheck(cfg, tile))
+    return -1;
+  size_t line = (size_t)tile->tileCols * tile->elem;
+  size_t stride = tile->stride ? tile->stride : line * tile->cols;
+  ssize_t total = line * tile->tileRows * tile->rows * tile->cols;
+
+  if(eTileDmaable(cfg, tile, matrix, stride)
+     && !eTileDma(cfg, tile, (char*)matrix, stride, 1))
+    return total;
+
+  uint8_t stage[ETILE_STAGE];
+  unsigned batch = line && line <= sizeof(stage) ? sizeof(stage) / line : 0;
+  for(unsigned r = 0; r < tile->rows; ++r)
+    for(unsigned c = 0; c < tile->cols; ++c) {
+      volatile uint8_t *dst = &cfg->lchip->eCoreRoot[tile->row + r][tile->col + c].sram[tile->offset];
+      const uint8_t *src = (const uint8_t*)matrix + r * tile->tileRows * stride + c * line;
+      if(stride == line || !batch) {
+        // contiguous already resp. rows are bursts on their own
+        for(unsigned i = 0; i < (stride == line ? 1 : tile->tileRows); ++i)
+          eCopy(dst + i * line, src + i * stride, stride == line ? line * tile->tileRows : line);
+        continue;
+      }
+      for(unsigned i = 0; i < tile->tileRows; i += batch) {
+        unsigned n = tile->tileRows - i < batch ? tile->tileRows - i : batch;
+        for(unsigned k = 0; k < n; ++k)
+          memcpy(stage + k * line, src + (i + k) * stride, line);
+        eCopy(dst + i * line, stage, n * line);
+      }
+    }
+  return total;
+}
+
+ssize_t eTileGather(eConfig_t *cfg, const eTile_t *tile, void *matrix)
+{
+  assert( cfg );
+  assert( tile );
+  assert( matrix || !tile->rows || !tile->cols );
+
+  if(eTileCheck(cfg, tile))
+    return -1;
+  size_t line = (size_t)tile->tileCols * tile->elem;
+  size_t stride = tile->stride ? tile->stride : line * tile->cols;
+  ssize_t total = line * tile->tileRows * tile->rows * tile->cols;
+
+  if(eTileDmaable(cfg, tile, matrix, stride)
+     && !eTileDma(cfg, tile, matrix, stride, 0))
+    return total;
+
+  uint8_t stage[ETILE_STAGE];
+  unsigned batch = line && line <= sizeof(stage) ? sizeof(stage) / line : 0;
+  for(unsigned r = 0; r < tile->rows; ++r)
+    for(unsigned c = 0; c < tile->cols; ++c) {
+      eCoreMemMap_t *eCore = &cfg->lchip->eCoreRoot[tile->row + r][tile->col + c];
+      uint8_t *dst = (uint8_t*)matrix + r * tile->tileRows * stride + c * line;
+      if(stride == line || !batch) {
+        for(unsigned i = 0; i < (stride == line ? 1 : tile->tileRows); ++i)
+          eDmaRead(cfg, eCore, tile->offset + i * line, dst + i * stride,
+                   stride == line ? line * tile->tileRows : line);
+        continue;
+      }
+      for(unsigned i = 0; i < tile->tileRows; i += batch) {
+        unsigned n = tile->tileRows - i < batch ? tile->tileRows - i : batch;
+        eDmaRead(cfg, eCore, tile->offset + i * line, stage, n * line);
+        for(unsigned k = 0; k < n; ++k)
+          memcpy(dst + (i + k) * stride, stage + k * line, line);
+      }
+    }
+  return total;
+}
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ehal-copy.h"
+#include "ehal-mmap.h"
+#include "ehal-print.h"
+#include "ehal-ring.h"
+#include "ehal-writev.h"
+
+// sort key of an item: global address above, position in the caller's vector
+// below, hence equal addresses keep the caller's order
+#define EWRITEV_KEY( dst, idx ) (((uint64_t)(dst) << 32) | (idx))
+#define EWRITEV_DST( key )      ((uintptr_t)((key) >> 32))
+#define EWRITEV_IDX( key )      ((uint32_t)(key))
+
+#define EWRITEV_STACK_ITEMS 256
+#define EWRITEV_STACK_STAGE 0x1000
+
+typedef struct {
+  volatile uint8_t *dst;            // NULL terminates the writer
+  const void *src;
+  size_t size;
+} eWritevRun_t;
+
+
+// small vectors (arguments) dominate, qsort()'s callback costs more than the
+// sorting itself there
+static void eWritevSort(uint64_t *k, unsigned n, uint64_t mask)
+{
+  while(n > 16) {
+    uint64_t a = k[0] & mask, b = k[n / 2] & mask, c = k[n - 1] & mask;
+    uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+    // Hoare, [0, j] <= pivot <= [j+1, n), both non-empty
+    unsigned i = ~0u, j = n;
+    for(;;) {
+      do ++i; while((k[i] & mask) < pivot);
+      do --j; while((k[j] & mask) > pivot);
+      if(i >= j)
+        break;
+      uint64_t t = k[i]; k[i] = k[j]; k[j] = t;
+    }
+    // recurse into the smaller part
+    if(j + 1 < n - j - 1) {
+      eWritevSort(k, j + 1, mask);
+      k += j + 1;
+      n -= j + 1;
+    }
+    else {
+      eWritevSort(k + j + 1, n - j - 1, mask);
+      n = j + 1;
+    }
+  }
+  for(unsigned i = 1; i < n; ++i) {
+    uint64_t v = k[i];
+    unsigned j = i;
+    for( ; j && (k[j - 1] & mask) > (v & mask); --j)
+      k[j] = k[j - 1];
+    k[j] = v;
+  }
+}
+
+static void* eWritevWriter(void *arg)
+{
+  eRingPort_t port = eRingConsumer((eRing_t*)arg);
+  for(;;) {
+    uint32_t n = eRingPeek(&port, EWRITEV_QUEUE);
+    if(!n)
+      sched_yield();
+    for(uint32_t i = 0; i < n; ++i) {
+      eWritevRun_t *run = eRingAt(&port, i);
+      if(!run->dst)
+        return NULL;
+      eCopy(run->dst, run->src, run->size);
+    }
+    eRingRelease(&port, n);
+  }
+}
+
+inline static volatile uint8_t* eWritevDst(eConfig_t *cfg, const eWriteVec_t *v)
+{
+  return &cfg->lchip->eCoreRoot[v->row][v->col].sram[v->offset];
+}
+
+inline static void eWritevEmit(eRingPort_t *port, const eWritevRun_t *run)
+{
+  if(!port) {
+    eCopy(run->dst, run->src, run->size);
+    return;
+  }
+  while(!eRingPush(port, run))
+    sched_yield();
+}
+
+ssize_t eWritev(eConfig_t *cfg, const eWriteVec_t *vec, unsigned n)
+{
+  assert( cfg );
+  assert( vec || !n );
+
+  size_t total = 0;
+  uintptr_t prevEnd = 0;
+  int ascending = 1;
+  for(unsigned i = 0; i < n; ++i) {
+    if(!eCoresAreMapped(cfg, vec[i].row, vec[i].col, 1, 1)
+       || vec[i].offset > sizeof(cfg->lchip->eCoreRoot[0][0].sram)
+       || vec[i].size > sizeof(cfg->lchip->eCoreRoot[0][0].sram) - vec[i].offset
+       || (!vec[i].buf && vec[i].size)) {
+      eCoresError("writev item %u (%u,%u) 0x%x+%zu out of bounds!\n",
+                  i, vec[i].row, vec[i].col, vec[i].offset, vec[i].size);
+      return -1;
+    }
+    total += vec[i].size;
+    uintptr_t dst = (uintptr_t)eWritevDst(cfg, &vec[i]);
+    ascending &= dst >= prevEnd;
+    prevEnd = dst + vec[i].size;
+  }
+  if(!n)
+    return 0;
+
+  // already in order and apart, e.g. the arguments of a group: no sort needed,
+  // adjoining items merge into runs while they fit the stack's stage
+  if(ascending && total < EWRITEV_PIPELINE) {
+    uint8_t stage[EWRITEV_STACK_STAGE];
+    for(unsigned i = 0, j; i < n; i = j) {
+      volatile uint8_t *dst = eWritevDst(cfg, &vec[i]);
+      size_t size = vec[i].size;
+      for(j = i + 1; j < n && eWritevDst(cfg, &vec[j]) == dst + size
+                     && size + vec[j].size <= sizeof(stage); ++j)
+        size += vec[j].size;
+
+      const void *src = vec[i].buf;
+      if(j - i > 1) {
+        for(unsigned k = i, off = 0; k < j; off += vec[k++].size)
+          memcpy(stage + off, vec[k].buf, vec[k].size);
+        src = stage;
+      }
+      if(size)
+        eCopy(dst, src, size);
+    }
+    return total;
+  }
+
+  uint64_t itemStack[EWRITEV_STACK_ITEMS], *item = itemStack;
+  uint8_t stageStack[EWRITEV_STACK_STAGE], *stage = stageStack;
+  if(n > EWRITEV_STACK_ITEMS)
+    item = malloc(n * sizeof(*item));
+  if(n > 1 && total > EWRITEV_STACK_STAGE)
+    stage = malloc(total);
+  if(!item || !stage) {
+    if(item != itemStack)
+      free(item);
+    if(stage != stageStack)
+      free(stage);
+    eCoresError("Could not allocate writev staging!\n");
+    return -1;
+  }
+  for(unsigned i = 0; i < n; ++i) {
+    uintptr_t dst = (uintptr_t)eWritevDst(cfg, &vec[i]);
+    assert( dst <= UINT32_MAX );        // host VA == Epiphany address
+    item[i] = EWRITEV_KEY( dst, i );
+  }
+  eWritevSort(item, n, ~0ull);
+
+  // merging of the next runs overlaps with the eLink writes of the previous
+  eRing_t *ring = NULL;
+  eRingPort_t port, *pport = NULL;
+  pthread_t writer;
+  if(total >= EWRITEV_PIPELINE && n > 1) {
+    void *mem = malloc(eRingBytes(EWRITEV_QUEUE, sizeof(eWritevRun_t)));
+    ring = eRingInit(mem, EWRITEV_QUEUE, sizeof(eWritevRun_t), 0);
+    if(ring && !pthread_create(&writer, NULL, eWritevWriter, ring)) {
+      port = eRingProducer(ring);
+      pport = &port;
+    }
+    else {
+      free(mem);
+      ring = NULL;
+    }
+  }
+
+  uint8_t *next = stage;
+  for(unsigned i = 0, j; i < n; i = j) {
+    // SRAMs of eCores are 1MB apart, runs never span two
+    uintptr_t bgn = EWRITEV_DST( item[i] ), end = bgn + vec[EWRITEV_IDX( item[i] )].size;
+    for(j = i + 1; j < n && EWRITEV_DST( item[j] ) <= end; ++j)
+      if(EWRITEV_DST( item[j] ) + vec[EWRITEV_IDX( item[j] )].size > end)
+        end = EWRITEV_DST( item[j] ) + vec[EWRITEV_IDX( item[j] )].size;
+
+    eWritevRun_t run = { (volatile uint8_t*)bgn, vec[EWRITEV_IDX( item[i] )].buf, end - bgn };
+    if(j - i > 1) {
+      // overlaps resolve in the caller's order
+      eWritevSort(&item[i], j - i, UINT32_MAX);
+      for(unsigned k = i; k < j; ++k)
+        memcpy(next + (EWRITEV_DST( item[k] ) - bgn), vec[EWRITEV_IDX( item[k] )].buf,
+               vec[EWRITEV_IDX( item[k] )].size);
+      run.src = next;
+      next += end - bgn;
+    }
+    if(run.size)
+      eWritevEmit(pport, &run);
+  }
+
+  if(pport) {
+    eWritevRun_t fin = { NULL, NULL, 0 };
+    eWritevEmit(pport, &fin);
+    pthread_join(writer, NULL);
+    free(ring);
+  }
+  if(stage != stageStack)
+    free(stage);
+  if(item != itemStack)
+    free(item);
+  return total;
+}
@@ -11,8 +11,20 @@
 #include <sys/time.h>
 #include <unistd.h>
 #define __DEFINE_ELOGLVL
+#include "ehal.h"
 #include "ehal-print.h"
 #include "ehal-mmap.h"
+#include "ehal-emulate.h"
+#include "ehal-async.h"
+#include "ehal-bulk.h"
+#include "ehal-copy.h"
+#include "ehal-dma.h"
+#include "ehal-fence.h"
+#include "alloc/ehal-region.h"
+#include "alloc/ehal-slab.h"
+#include "alloc/ehal-stats.h"
+#include "alloc/ehal-tcache.h"
+#include "broker/ehal-broker.h"
 #include "loader/ehal-hdf-loader.h"
 #include "memmap-epiphany-system.h"
 #include "state/ident-adapteva-epiphany.h"
@@ -58,8 +70,7 @@ void eEastLinkUp(__typeof__(&((eSysRegs*)0x0)->esysconfig.reg) esysconfig,
   if(type == E16G301) { // TODO: assume one chip
 //	  if ((e_platform.type == E_ZEDBOARD1601) || (e_platform.type == E_PARALLELLA1601))
     assert((ELINK_REG_MASK( ELINK_REG_EAST ) << 28) == 0x50000000);
-    *esysconfig = ELINK_REG_MASK( ELINK_REG_EAST ) << 28;
-    __asm__ volatile("" ::: "memory");
+    eStoreOrdered(esysconfig, ELINK_REG_MASK( ELINK_REG_EAST ) << 28);
 
 // The register must be written, there shall be NO read beforehand. Otherwise stall!
 //                      E16G301               E64G301
@@ -69,17 +80,16 @@ void eEastLinkUp(__typeof__(&((eSysRegs*)0x0)->esysconfig.reg) esysconfig,
 //    assert(elinkmodecfg == (volatile uint32_t*)0x88bf0300);
 
 //  LCLK Transmit Frequency control: Divide cclk by 0->2, 1->4, 2->8
-    *elinkmodecfgEast = 1;
-    __asm__ volatile("" ::: "memory");
-    *esysconfig = 0x0;
+    eStoreOrdered(elinkmodecfgEast, 1);
+    eStoreOrdered(esysconfig, 0x0);
   }
 }
 
 #if 0
 void eCoresReset(void)
 {
-  esysregs->esysreset = 0x0;
-  __asm__ volatile("" ::: "memory");
+  eStoreOrdered(&esysregs->esysreset, 0x0);
+  eFenceComplete();
   usleep(200000);
 
   eEastLinkUp(&esysregs->esysconfig.reg); // FIXME
@@ -87,19 +97,107 @@ void eCoresReset(void)
 #endif
 
 
+const char* eBootPhaseToStr(eBootPhase_t phase)
+{
+  const char *str[] = {
+    [EBOOT_HDF]     = "HDF parse",
+    [EBOOT_DEVICE]  = "device open",
+    [EBOOT_SYSREGS] = "sysregs map",
+    [EBOOT_CORES]   = "eCores map",
+    [EBOOT_ELINK]   = "eLink up",
+    [EBOOT_SHM]     = "shm map",
+    [EBOOT_MSPACE]  = "mspace create"
+  };
+
+  if((unsigned)phase >= elemsof(str))
+    return "undefined";
+
+  return str[phase];
+}
+
+unsigned long eCoresBootPhaseUs(eBootPhase_t phase)
+{
+  if((unsigned)phase >= EBOOT_PHASES)
+    return 0;
+
+  return ecfg.bootUs[phase];
+}
+
+unsigned long eCoresBootUs(void)
+{
+  unsigned long us = 0;
+  for(unsigned i=0; i<EBOOT_PHASES; ++i)
+    us += ecfg.bootUs[i];
+  return us;
+}
+
+// eCores mapped, the leased rectangle resp. the whole chip
+static void eCoresMapped(eConfig_t *ecfg, eCoreMemMap_t **eCoreBgn, eCoreMemMap_t **eCoreEnd)
+{
+  __typeof__(&ecfg->chip[0]) chip = &ecfg->chip[0];
+  if(ecfg->leased) {
+    *eCoreBgn = &chip->eCoreRoot[ebrokerLease.row][ebrokerLease.col];
+    *eCoreEnd = &chip->eCoreRoot[ebrokerLease.row + ebrokerLease.rows - 1][ebrokerLease.col + ebrokerLease.cols - 1];
+  }
+  else {
+    *eCoreBgn = &chip->eCoreRoot[0][0];
+    *eCoreEnd = &chip->eCoreRoot[chip->xyDim-1][chip->xyDim-1];
+  }
+}
+
+int eCoresAreMapped(const eConfig_t *cfg, unsigned row, unsigned col, unsigned rows, unsigned cols)
+{
+  unsigned r0 = 0, c0 = 0, nr = cfg->lchip->xyDim, nc = cfg->lchip->xyDim;
+  if(cfg->leased) {
+    r0 = ebrokerLease.row;
+    c0 = ebrokerLease.col;
+    nr = ebrokerLease.rows;
+    nc = ebrokerLease.cols;
+  }
+  return row >= r0 && rows <= nr && row - r0 <= nr - rows
+         && col >= c0 && cols <= nc && col - c0 <= nc - cols;
+}
+
+int eShmIsMapped(const eConfigMem_t *emem, const volatile void *p, size_t size)
+{
+  const char *bgn = emem->epi_base + emem->map_offset;
+  size_t off = (size_t)((const char*)p - bgn);
+  return p && (const char*)p >= bgn && off <= emem->map_size && size <= emem->map_size - off;
+}
+
+static void eBootPhaseDone(eConfig_t *ecfg, eBootPhase_t phase, struct timeval *tprev)
+{
+  struct timeval tcur;
+  gettimeofday(&tcur, NULL);
+  ecfg->bootUs[phase] = (tcur.tv_sec * 1000000 + tcur.tv_usec) - (tprev->tv_sec * 1000000 + tprev->tv_usec);
+  *tprev = tcur;
+
+  eCoresPrintf(E_DBG, "Bootstrap: %-14s in ~%ld μs\n", eBootPhaseToStr(phase), ecfg->bootUs[phase]);
+}
+
 int eCoresBootstrap(eConfig_t *ecfg)
 {
+  struct timeval tphase;
+  memset(ecfg->bootUs, 0, sizeof(ecfg->bootUs));
+  gettimeofday(&tphase, NULL);
+
   // Idea: We need to read the HDF to get initial values:
   //       - esys_regs_base
   //       - first core id e.g. 0x80800000
   //       With this information, one can read the FPGA reg and compare.
   //       hardware values will take precidice.
   //       TODO: Next step could be to execute code on cores to evaluate next HDF values.
+  // An emulated EPIPHANY simply sticks to the default cfg.
+  int emulate = eEmuRequested();
   eConfig_t ecfgHdf;
   if(load_default_hdf(&ecfgHdf)) {
-    eCoresError("Failed to obtain HDF file! Aborting...\n");
-    return -1;
+    if(!emulate) {
+      eCoresError("Failed to obtain HDF file! Aborting...\n");
+      return -1;
+    }
+    eCoresWarn("Failed to obtain HDF file! Emulating default cfg...\n");
   }
+  eBootPhaseDone(ecfg, EBOOT_HDF, &tphase);
   // TODO: implement some logic to combine
 //  if(memcmp(ecfg, &ecfgHdf, sizeof(*ecfg))) {
 //    eCoresError("Supplied HDF is different to default cfg! Aborting...\n");
@@ -117,62 +215,104 @@ int eCoresBootstrap(eConfig_t *ecfg)
   ecfg->lchip->eCoreCfg[ ELINK_REG_WEST ] = &ecfg->lchip->eCoreRoot[2][ ecfg->lchip->type == E16G301 ? 0 : 4 ];
 
 
-  eCoresPrintf(E_DBG, "Opening EPIPHANY.\n" );
-  struct { int err; const char* dev; } edev[] = {
-    { -1, "/dev/epiphany/mesh0" },
-    { -1, "/dev/epiphany" },
-    { -1, "/dev/mem" }
-  };
-
-  unsigned edevc = elemsof(edev);
-  for(unsigned i=0; i<edevc; ++i) {
-    if((ecfg->fd = open(edev[i].dev, O_RDWR|O_SYNC|O_EXCL)) != -1) // TODO: check if file ...
-      break;
-    edev[i].err = errno;
+  // In case a broker owns the EPIPHANY, it already is bootstrapped.
+  // We solely obtain its fd and a lease of eCores and eMem.
+  const char *broker = getenv("EHAL_BROKER");
+  if(broker) {
+    eCoresPrintf(E_DBG, "Leasing EPIPHANY from broker '%s'.\n", broker );
+    if(eBrokerAcquire(broker, &ebrokerLease, ecfg->lchip, &ecfg->fd)) {
+      eCoresError("Could not lease EPIPHANY! Cleaning up...\n");
+      return -1;
+    }
   }
-  if(ecfg->fd == -1) {
-    eCoresError("Could not open EPIPHANY!, tried:\n");
-    for(unsigned i=0; i<edevc; ++i)
-      eCoresError("    '%s' (%s)\n", edev[i].dev, strerror(edev[i].err));
-    eCoresError("Cleaning up...\n");
-    return -1;
+  else if(emulate) {
+    if(eEmuOpen(ecfg)) {
+      eCoresError("Could not emulate EPIPHANY! Cleaning up...\n");
+      return -1;
+    }
   }
+  else {
+    eCoresPrintf(E_DBG, "Opening EPIPHANY.\n" );
+    struct { int err; const char* dev; } edev[] = {
+      { -1, "/dev/epiphany/mesh0" },
+      { -1, "/dev/epiphany" },
+      { -1, "/dev/mem" }
+    };
+
+    unsigned edevc = elemsof(edev);
+    for(unsigned i=0; i<edevc; ++i) {
+      if((ecfg->fd = open(edev[i].dev, O_RDWR|O_SYNC|O_EXCL)) != -1) // TODO: check if file ...
+        break;
+      edev[i].err = errno;
+    }
+    if(ecfg->fd == -1) {
+      eCoresError("Could not open EPIPHANY!, tried:\n");
+      for(unsigned i=0; i<edevc; ++i)
+        eCoresError("    '%s' (%s)\n", edev[i].dev, strerror(edev[i].err));
+      eCoresError("Cleaning up...\n");
+      return -1;
+    }
+  }
+  eBootPhaseDone(ecfg, EBOOT_DEVICE, &tphase);
 
   eCoresPrintf(E_DBG, "Setting up EPIPHANY eCores, esysregs and shm to Zynq FPGA\n" );
 
   // The EPIPHANY FPGA regs visible by the Zynq, are mapped onto the [32, 8] eCore regs memory mapped page
-  if(!eSysRegsMmap(ecfg->fd, ecfg->esys_regs_base)) {
+  // A leased client leaves them alone, the broker identified the chip already.
+  ecfg->leased = broker != NULL;
+  if(broker || !eSysRegsMmap(ecfg->fd, ecfg->esys_regs_base)) {
     eSysRegs* esysregs = ecfg->esys_regs_base;
     __typeof__(&ecfg->chip[0]) chip = &ecfg->chip[0];
 
     // as the FPGA regs are now visible, we can check what configuration is given.
     // let us rather trust FPGA then HDF file
-    eChip_t hw_eChipType = eChipType(esysregs);
+    eChip_t hw_eChipType = broker ? chip->type : eChipType(esysregs);
     if(chip->type != hw_eChipType) {
       eCoresWarn("HW identification different then HDF! Will use HW!\n");
       chip->type  = hw_eChipType;
       chip->xyDim = ECHIP_GET_DIM(hw_eChipType);
     }
+    eBootPhaseDone(ecfg, EBOOT_SYSREGS, &tphase);
 
     eCoreMemMap_t* eCoreBgn = &chip->eCoreRoot[0][0];
     eCoreMemMap_t* eCoreEnd = &chip->eCoreRoot[chip->xyDim-1][chip->xyDim-1];
     eCoresPrintf(E_DBG, "Identified EPIPHANY eCores (%p-%p), xydim: %dx%d\n",
                  eCoreBgn, eCoreEnd, chip->xyDim, chip->xyDim);
 
+    // a leased client solely maps its rectangle
+    eCoresMapped(ecfg, &eCoreBgn, &eCoreEnd);
+
     if(!eCoreMmap(ecfg->fd, eCoreBgn, eCoreEnd)) {
+      eBootPhaseDone(ecfg, EBOOT_CORES, &tphase);
 
       // after the mmap'ed regions are up, let us enable the east elink:
-      eEastLinkUp(&esysregs->esysconfig.reg, chip->eCoreRoot, chip->type); // FIXME
-      eCoresPrintf(E_DBG, "Zynq <-> EPIPHANY: Enabled EAST eLink\n");
+      // (the broker did so already for its clients)
+      if(!broker) {
+        eEastLinkUp(&esysregs->esysconfig.reg, chip->eCoreRoot, chip->type); // FIXME
+        eCoresPrintf(E_DBG, "Zynq <-> EPIPHANY: Enabled EAST eLink\n");
+      }
+      eBootPhaseDone(ecfg, EBOOT_ELINK, &tphase);
 
+      // a leased client solely maps and owns its eMem range, the heap must not exceed it
       __typeof__(&ecfg->emem[0]) cemem = &ecfg->emem[0];
+      cemem->map_offset = broker ? ebrokerLease.ememOffset : 0;
+      cemem->map_size = broker ? ebrokerLease.ememSize : cemem->size;
       if(!eShmMmap(ecfg->fd, cemem)) {
-      
-        cemem->space = create_mspace_with_base(cemem->epi_base,
-                                               cemem->size, 1);
+        eBootPhaseDone(ecfg, EBOOT_SHM, &tphase);
+
+        // the heap below, the region area for exact offsets at the top
+        char *spaceBase = cemem->epi_base + cemem->map_offset;
+        size_t spaceSize = cemem->map_size - eRegionAreaSize(cemem->map_size);
+        cemem->space = create_mspace_with_base(spaceBase, spaceSize, 1);
         if(cemem->space != 0) {
-          if(mspace_set_footprint_limit(cemem->space, cemem->size) == cemem->size)
-            return 0;
+          if(mspace_set_footprint_limit(cemem->space, spaceSize) == spaceSize
+             && !eSlabInit(cemem)) {
+            if(!eRegionInit(cemem, spaceBase, cemem->map_size, spaceSize)) {
+              eBootPhaseDone(ecfg, EBOOT_MSPACE, &tphase);
+              return 0;
+            }
+            eSlabFini(cemem);
+          }
           
           destroy_mspace(cemem->space);
         }
@@ -183,28 +323,225 @@ int eCoresBootstrap(eConfig_t *ecfg)
       eCoreMunmap(eCoreBgn, eCoreEnd);
     }
 
-    eSysRegsMunmap(ecfg->esys_regs_base);
+    if(!broker)
+      eSysRegsMunmap(ecfg->esys_regs_base);
   }
 
   close(ecfg->fd);
+  ecfg->fd = -1;
+  eBrokerRelease();
 
   return -1;
 }
 
+char* eShmApertureOpen(int mode)
+{
+  if(eShmCachedMmap(ecfg.fd, ecfg.lemem, mode))
+    return NULL;
+  return ecfg.lemem->cached_base;
+}
+
+void eShmApertureClose(void)
+{
+  eShmCachedMunmap(ecfg.lemem);
+}
+
+void eMemStoreRelaxed(volatile void *dst, const void *src, size_t size)
+{
+  assert( dst || !size );
+  assert( src || !size );
+
+  eConfigMem_t *emem = ecfg.lemem;
+  if(!emem->cached_base || !emem->cached_wc || !eShmIsMapped(emem, dst, size)) {
+    eCopy(dst, src, size);
+    return;
+  }
+  memcpy(eShmEpiToAperture(emem, (char*)(uintptr_t)dst), src, size);
+}
+
+void eShmFlush(const void *addr, size_t size)
+{
+  eShmCacheClean(addr, size);
+}
+
+void eShmInvalidate(const void *addr, size_t size)
+{
+  eShmCacheInvalidate(addr, size);
+}
+
+eMemPtr_t eMemAlloc(size_t size)
+{
+  eMemPtr_t p = eTcacheAlloc(ecfg.lemem, size);
+  eStatsTrace(p.eaddr, (int32_t)size);
+  return p;
+}
+
+void eMemFree(void *host)
+{
+  eStatsTrace(host ? eMemHostToEpi(ecfg.lemem, host) : 0, -1);
+  eTcacheFree(ecfg.lemem, host);
+}
+
+eArena_t* eMemArenaCreate(uint32_t size)
+{
+  eMemPtr_t p = eMemAlloc(size);
+  eArena_t *arena = eArenaInit(p.host, size, p.eaddr);
+  if(!arena)
+    eMemFree(p.host);
+  return arena;
+}
+
+void eMemArenaDestroy(eArena_t *arena)
+{
+  eMemFree(arena);
+}
+
+eRing_t* eMemRingCreate(uint32_t slots, uint32_t slotSize, unsigned flags)
+{
+  eMemPtr_t p = { NULL, 0 };
+  if(slots && !(slots & (slots - 1)) && slotSize
+     && (uint64_t)slots * slotSize <= ecfg.lemem->size)
+    p = eMemAlloc(eRingBytes(slots, slotSize));
+  eRing_t *ring = eRingInit(p.host, slots, slotSize, flags);
+  if(!ring)
+    eMemFree(p.host);
+  return ring;
+}
+
+void eMemRingDestroy(eRing_t *ring)
+{
+  eMemFree(ring);
+}
+
+ssize_t eCoreRead(unsigned row, unsigned col, uint32_t offset, void *dst, size_t size)
+{
+  if(!eCoresAreMapped(&ecfg, row, col, 1, 1))
+    return -1;
+  return eDmaRead(&ecfg, &ecfg.lchip->eCoreRoot[row][col], offset, dst, size);
+}
+
+eView_t eCoreView(unsigned row, unsigned col, uint32_t offset, size_t size)
+{
+  if(!eCoresAreMapped(&ecfg, row, col, 1, 1)
+     || offset > sizeof(ecfg.lchip->eCoreRoot[0][0].sram)
+     || size > sizeof(ecfg.lchip->eCoreRoot[0][0].sram) - offset) {
+    eCoresError("view of %zuB at 0x%x exceeds the SRAM of eCore (%u,%u)!\n", size, offset, row, col);
+    return (eView_t){ NULL, 0 };
+  }
+  return (eView_t){ (void*)(uintptr_t)&ecfg.lchip->eCoreRoot[row][col].sram[offset], size };
+}
+
+eView_t eMemView(void *host, size_t size)
+{
+  if(!eShmIsMapped(ecfg.lemem, host, size)) {
+    eCoresError("view of %zuB at %p exceeds the eMem!\n", size, host);
+    return (eView_t){ NULL, 0 };
+  }
+  return (eView_t){ host, size };
+}
+
+int eCoreDmaMove(unsigned row, unsigned col, unsigned chan, uint32_t slot,
+                 uint32_t dst, uint32_t src, size_t size)
+{
+  if(!eCoresAreMapped(&ecfg, row, col, 1, 1) || chan >= 2)
+    return -1;
+  return eDmaMove(&ecfg.lchip->eCoreRoot[row][col], chan, slot, dst, src, size);
+}
+
+int eCoreDmaWait(unsigned row, unsigned col, unsigned chan)
+{
+  if(!eCoresAreMapped(&ecfg, row, col, 1, 1) || chan >= 2)
+    return -1;
+  return eDmaWait(&ecfg.lchip->eCoreRoot[row][col], chan, EDMA_TIMEOUT_US);
+}
+
+ssize_t eCoreWritev(const eWriteVec_t *vec, unsigned n)
+{
+  return eWritev(&ecfg, vec, n);
+}
+
+ssize_t eCoreTileScatter(const eTile_t *tile, const void *matrix)
+{
+  return eTileScatter(&ecfg, tile, matrix);
+}
+
+ssize_t eCoreTileGather(const eTile_t *tile, void *matrix)
+{
+  return eTileGather(&ecfg, tile, matrix);
+}
+
+const eConfigMem_t* eMemRegion(void)
+{
+  return ecfg.lemem;
+}
+
+int eMemStats(eMemStats_t *stats)
+{
+  return eStatsGet(ecfg.lemem, stats);
+}
+
+void eMemStatsPrint(FILE *out)
+{
+  eMemStats_t stats;
+  if(!eStatsGet(ecfg.lemem, &stats))
+    eStatsPrint(out, &stats);
+}
+
+int eMemTraceStart(unsigned entries)
+{
+  return eStatsTraceStart(entries);
+}
+
+void eMemTraceStop(void)
+{
+  eStatsTraceStop();
+}
+
+size_t eMemTraceRead(eMemTrace_t *out, size_t n)
+{
+  return eStatsTraceRead(out, n);
+}
+
+eMemPtr_t eMemReserve(uint32_t offset, size_t size)
+{
+  eMemPtr_t p = { NULL, 0 };
+  if(size <= UINT32_MAX)
+    p.host = eRegionReserve(ecfg.lemem, offset, (uint32_t)size);
+  if(p.host)
+    p.eaddr = eMemHostToEpi(ecfg.lemem, p.host);
+  return p;
+}
+
+int eMemRelease(uint32_t offset)
+{
+  return eRegionRelease(ecfg.lemem, offset);
+}
+
 void eCoresFini(eConfig_t *ecfg)
 {
+  eAsyncStop();
+  eBulkFini();
+  eRegShadowFini();
+  eTcacheFlush();
+  if(eloglevel >= E_DBG)
+    eMemStatsPrint(stdout);
+  eStatsTraceFini();
+  eRegionFini(&ecfg->emem[0]);
+  eSlabFini(&ecfg->emem[0]);
   destroy_mspace(ecfg->emem[0].space);
+  eShmCachedMunmap(&ecfg->emem[0]);
   eShmMunmap(&ecfg->emem[0]);
 
-  __typeof__(&ecfg->chip[0]) chip = &ecfg->chip[0];
-  eCoreMemMap_t* eCoreBgn = &chip->eCoreRoot[0][0];
-  eCoreMemMap_t* eCoreEnd = &chip->eCoreRoot[chip->xyDim-1][chip->xyDim-1];
+  eCoreMemMap_t *eCoreBgn, *eCoreEnd;
+  eCoresMapped(ecfg, &eCoreBgn, &eCoreEnd);
   eCoreMunmap(eCoreBgn, eCoreEnd);
 
-  eSysRegsMunmap(ecfg->esys_regs_base);
+  if(!ecfg->leased)
+    eSysRegsMunmap(ecfg->esys_regs_base);
 
   close(ecfg->fd);
   ecfg->fd = -1;
+  eBrokerRelease();
 }
 
 
@@ -327,7 +664,11 @@ static void init(void)
   char *eloglevels = getenv ("ELOGLEVEL");
   eloglevel = (eloglevels == NULL) ? 0 : atoi(eloglevels);
 
-  if(getuid()) {
+  // Clients of a broker obtain the device fd, an emulated one is a memfd,
+  // no need for root
+  if(!getenv("EHAL_BROKER")
+     && !eEmuRequested()
+     && getuid()) {
     eCoresError("You are not root! Solely root can open devices! Aborting...\n");
     exit(-1);
   }
@@ -361,12 +702,13 @@ static void init(void)
          "         └─┴─┺━┹─┘[%2d,%2d]           └─┴─┴···┴─┴─┘[%2d,%2d]\n"
          "             S\n"
          "\n"
-         "Init in ~%ld μs (~%ldt Inst.)\n"
-         "\n",
+         "Init in ~%ld μs (~%ldt Inst.)\n",
          xlxZynqDevice(ecfg.fd),
          xlxZynqSiliconRevision(ecfg.fd),
-         eChipTypeToStr(ecfg.esys_regs_base), eChipCapsToStr(ecfg.esys_regs_base),
-         eChipRevision(ecfg.esys_regs_base),
+         // a leased client has no FPGA regs mapped
+         ecfg.leased ? "leased" : eChipTypeToStr(ecfg.esys_regs_base),
+         ecfg.leased ? "broker" : eChipCapsToStr(ecfg.esys_regs_base),
+         ecfg.leased ? 0 : eChipRevision(ecfg.esys_regs_base),
          eCoreBgn, ((uint8_t*)(eCoreEnd + 1))-1,
          ECORE_ADDR_ROWID(eCoreBgn), ECORE_ADDR_COLID(eCoreBgn),
          ECORE_ADDR_ROWID(eCoreEnd), ECORE_ADDR_COLID(eCoreEnd),
@@ -379,6 +721,10 @@ static void init(void)
          ECORE_ADDR_ROWID(eCoreEnd), ECORE_ADDR_COLID(eCoreEnd),
          ECORE_ADDR_ROWID((void*)(emem->epi_base+emem->size-1)), ECORE_ADDR_COLID((void*)(emem->epi_base+emem->size-1)),
          init_us, (init_us * 667 /* MHz -> Zynq frequency */)/1000 );
+
+  for(unsigned i=0; i<EBOOT_PHASES; ++i)
+    eCoresPrintf(E_INF, "%s %-14s ~%ld μs\n%s", i < EBOOT_PHASES-1 ? "├" : "└",
+                 eBootPhaseToStr(i), ecfg.bootUs[i], i < EBOOT_PHASES-1 ? "" : "\n");
 }
 
 __attribute__((destructor /*(101)*/)) /* prios 0-100 are preserved */
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* O_DIRECT, pread, pwrite, posix_fadvise */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "loader/ehal-data-loader.h"
+#include "ehal-print.h"
+
+struct edata_job_s {
+  pthread_t thread;
+  char *fname;                      // own copy, the caller's might be gone
+  off_t foff;
+  char *mem;
+  size_t size;
+  int store;
+  ssize_t ret;
+};
+
+
+inline static int data_aligned(uintptr_t x)
+{
+  return !(x & (EDATA_ALIGN - 1));
+}
+
+static ssize_t data_xfer(const char *fname, off_t foff, char *mem, size_t size, int store)
+{
+  int flags = store ? (O_WRONLY | O_CREAT) : O_RDONLY;
+  int fd = open(fname, flags | O_CLOEXEC, 0644);
+  if(fd < 0) {
+    eCoresError("Could not open %s, %s\n", fname, strerror(errno));
+    return -1;
+  }
+
+  if(!store && !size) {
+    struct stat s;
+    if(fstat(fd, &s) < 0 || s.st_size < foff) {
+      eCoresError("Could not fstat %s, %s\n", fname, strerror(errno));
+      close(fd);
+      return -1;
+    }
+    size = s.st_size - foff;
+  }
+  if(!store)
+    posix_fadvise(fd, foff, size, POSIX_FADV_SEQUENTIAL);
+
+  // e.g. tmpfs and /dev/mem mappings (EFAULT) refuse O_DIRECT
+  int fdDirect = open(fname, (flags & ~O_CREAT) | O_DIRECT | O_CLOEXEC);
+
+  size_t done = 0;
+  while(done < size) {
+    size_t chunk = size - done < EDATA_CHUNK ? size - done : EDATA_CHUNK;
+    int direct = fdDirect >= 0
+                 && data_aligned((uintptr_t)(mem + done))
+                 && data_aligned((uintptr_t)(foff + done))
+                 && chunk >= EDATA_ALIGN;
+    if(direct)
+      chunk &= ~(size_t)(EDATA_ALIGN - 1);
+
+    int cfd = direct ? fdDirect : fd;
+    ssize_t r = store ? pwrite(cfd, mem + done, chunk, foff + done)
+                      : pread(cfd, mem + done, chunk, foff + done);
+    if(r < 0 && errno == EINTR)
+      continue;
+    if(r < 0 && direct && (errno == EINVAL || errno == EFAULT)) {
+      eCoresPrintf(E_DBG, "No O_DIRECT for %s (%s), falling back\n", fname, strerror(errno));
+      close(fdDirect);
+      fdDirect = -1;
+      continue;
+    }
+    if(r < 0) {
+      eCoresError("Could not %s %s, %s\n", store ? "write" : "read", fname, strerror(errno));
+      break;
+    }
+    if(!r) // EOF
+      break;
+    done += r;
+  }
+
+  if(fdDirect >= 0)
+    close(fdDirect);
+  close(fd);
+  eCoresPrintf(E_DBG, "%s %s of %s\n", store ? "Stored" : "Loaded", fmtBytes(done), fname);
+  return done || !size ? (ssize_t)done : -1;
+}
+
+ssize_t load_data(const char *fname, off_t foff, void *dst, size_t size)
+{
+  assert( fname );
+  assert( dst );
+  return data_xfer(fname, foff, dst, size, 0);
+}
+
+ssize_t store_data(const char *fname, off_t foff, const void *src, size_t size)
+{
+  assert( fname );
+  assert( src );
+  return data_xfer(fname, foff, (char*)src, size, 1);
+}
+
+static void* data_thread(void *arg)
+{
+  edata_job_t *job = arg;
+  job->ret = data_xfer(job->fname, job->foff, job->mem, job->size, job->store);
+  return NULL;
+}
+
+static edata_job_t* data_async(const char *fname, off_t foff, char *mem, size_t size, int store)
+{
+  edata_job_t *job = malloc(sizeof(*job));
+  if(job) {
+    *job = (edata_job_t){ .fname = strdup(fname), .foff = foff, .mem = mem, .size = size, .store = store };
+    if(job->fname && !pthread_create(&job->thread, NULL, data_thread, job))
+      return job;
+    free(job->fname);
+    free(job);
+  }
+  eCoresError("Could not start background transfer of %s\n", fname);
+  return NULL;
+}
+
+edata_job_t* load_data_async(const char *fname, off_t foff, void *dst, size_t size)
+{
+  assert( fname );
+  assert( dst );
+  return data_async(fname, foff, dst, size, 0);
+}
+
+edata_job_t* store_data_async(const char *fname, off_t foff, const void *src, size_t size)
+{
+  assert( fname );
+  assert( src );
+  return data_async(fname, foff, (char*)src, size, 1);
+}
+
+ssize_t data_wait(edata_job_t *job)
+{
+  if(!job)
+    return -1;
+  pthread_join(job->thread, NULL);
+  ssize_t ret = job->ret;
+  free(job->fname);
+  free(job);
+  return ret;
+}
@@ -11,6 +11,7 @@
 #include <string.h>
 #include "memmap-epiphany-cores.h"
 #include "ehal-print.h"
+#include "ehal-copy.h"
 #include "loader/ehal-gen-file-loader.h"
 
 
@@ -119,14 +120,7 @@ int srecPairsToBytes_eCoreLocal(unsigned char* addr,
 
       eCoreMemMap_t* cur = (eCoreMemMap_t*)(r | c);
       volatile unsigned char* eaddr = cur->sram + (uintptr_t)addr;
-
-#if 1
-      unsigned s;
-      for(s = 0; s < srecPairs; s++)
-        eaddr[s] = buf[s];
-#else
-      memcpy(eaddr, buf, srecPairs);
-#endif
+      eCopy(eaddr, buf, srecPairs);
     }
   }
   return 0;
@@ -154,6 +148,8 @@ typedef struct {
   eCoreMemMap_t* eCoreEnd;
   char* eMemBase;
   uint32_t eMemSize;
+  uint32_t localBgn;                // extent of the eCore local records
+  uint32_t localEnd;
 } eCores;
 
 //int parse_srec(unsigned char *srecBgn, unsigned char *srecEnd,
@@ -256,9 +252,23 @@ int handle_srec(unsigned char* srecBgn, unsigned char* srecEnd, void* pass)
         __typeof__(epass->eCoreBgn) eCoreBgn = epass->eCoreBgn;
         __typeof__(epass->eCoreEnd) eCoreEnd = epass->eCoreEnd;
 
-        // 1) local
         if( ! ECORE_ADDR_ROWID(addr)
            && ! ECORE_ADDR_COLID(addr) ) {
+          if(addr < epass->localBgn)
+            epass->localBgn = addr;
+          if(addr + dataBytes > epass->localEnd)
+            epass->localEnd = addr + dataBytes;
+        }
+
+        // 0) no eCores, solely the extent is of interest
+        if( ! eCoreBgn ) {
+          if(srecPairsToBytes((unsigned char*)buf,
+                              srecData, data__srecPairs, &chksum))
+            return -1;
+        }
+        // 1) local
+        else if( ! ECORE_ADDR_ROWID(addr)
+           && ! ECORE_ADDR_COLID(addr) ) {
           if(srecPairsToBytes_eCoreLocal((unsigned char*)addr, eCoreBgn, eCoreEnd,
                                          srecData, data__srecPairs, &chksum))
             return -1; // One could also just warn that a line is broken
@@ -271,9 +281,10 @@ int handle_srec(unsigned char* srecBgn, unsigned char* srecEnd, void* pass)
                 // 2b) eDRAM
                 || (epass->eMemBase <= (char*)addr
                     && (char*)addr < (epass->eMemBase+epass->eMemSize))) {
-          if(srecPairsToBytes((unsigned char*)addr,
+          if(srecPairsToBytes((unsigned char*)buf,
                               srecData, data__srecPairs, &chksum))
             return -1; // One could also just warn that a line is broken
+          eCopy((volatile void*)addr, buf, data__srecPairs);
         }
         
         ++recCount;
@@ -394,3 +405,24 @@ int load_srec(const char *srecFile, eCoreMemMap_t* eCoreBgn, eCoreMemMap_t* eCor
   return load_file(srecFile, elemsof(ext), ext, handle_srec, &data);
 }
 
+// public API
+int extent_srec(const char *srecFile, uint32_t *localBgn, uint32_t *localEnd)
+{
+  const char *ext[] = {
+    "srec", "sx", "mot", "mxt", "exo",
+    "s19", "s28", "s37", "s", "s1", "s2", "s3"
+  };
+
+  eCores data = {
+    .eCoreBgn = NULL,
+    .eCoreEnd = NULL,
+    .localBgn = UINT32_MAX,
+    .localEnd = 0
+  };
+  int ret = load_file(srecFile, elemsof(ext), ext, handle_srec, &data);
+  if(!ret) {
+    *localBgn = data.localEnd ? data.localBgn : 0;
+    *localEnd = data.localEnd;
+  }
+  return ret;
+}
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#define _GNU_SOURCE /* setenv, msync */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "ehal.h"
+#include "broker/ehal-broker.h"
+
+extern eConfig_t ecfg;
+
+static int mapped(const volatile void *addr)
+{
+  return !msync((void*)((uintptr_t)addr & ~(uintptr_t)0xFFF), 0x1000, MS_ASYNC);
+}
+
+// leased from the broker by the parent, solely the lease is mapped
+static int client(void)
+{
+  eConfigMem_t *emem = ecfg.lemem;
+  eCoresGMemMap root = ecfg.lchip->eCoreRoot;
+  eMemPtr_t p = eMemAlloc(0x1000);
+  if(!ecfg.leased
+     || !mapped(root[1][1].sram) || !mapped(root[2][2].sram)
+     || mapped(root[0][0].sram) || mapped(root[3][3].sram)
+     || mapped(ecfg.esys_regs_base)
+     || !mapped(emem->epi_base + emem->map_offset)
+     || mapped(emem->epi_base + emem->map_offset + emem->map_size)
+     || (char*)p.host < emem->epi_base + emem->map_offset
+     || (char*)p.host >= emem->epi_base + emem->map_offset + emem->map_size) {
+    printf("lease maps beyond (1,1) 2x2, eMem [0x%x:+0x%x]\n", emem->map_offset, emem->map_size);
+    return 1;
+  }
+  eMemFree(p.host);
+
+  // beyond the lease refused, instead of faulting
+  unsigned char buf[64];
+  eWriteVec_t vec = { 0, 0, 0x100, buf, sizeof(buf) };
+  eTile_t tile = { 1, 1, 2, 2, 0x2000, 2, 2, 1, 0, 0, 0 };
+  if(eCoreRead(0, 0, 0x100, buf, sizeof(buf)) != -1
+     || eCoreRead(3, 3, 0x100, buf, sizeof(buf)) != -1
+     || eCoreView(1, 3, 0x100, sizeof(buf)).base
+     || eCoreDmaWait(0, 1, 0) != -1
+     || eCoreWritev(&vec, 1) != -1
+     || eMemView(emem->epi_base + emem->map_offset + emem->map_size - 8, 16).base
+     || eCoreRead(1, 1, 0x100, buf, sizeof(buf)) != sizeof(buf)
+     || eCoreTileScatter(&tile, buf) != 16) {
+    printf("access beyond the lease not refused\n");
+    return 1;
+  }
+  tile.rows = 3;
+  return eCoreTileScatter(&tile, buf) == -1 ? 0 : 1;
+}
+
+static int lease(const char *path, const char *cores, const char *emem)
+{
+  eBrokerLease_t l;
+  eConfigChip_t chip = ecfg.chip[0];
+  int fd = -1;
+  setenv("EHAL_LEASE_CORES", cores, 1);
+  if(emem)
+    setenv("EHAL_LEASE_EMEM", emem, 1);
+  else
+    unsetenv("EHAL_LEASE_EMEM");
+  if(eBrokerAcquire(path, &l, &chip, &fd))
+    return -1;
+  close(fd);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc > 1 && !strcmp(argv[1], "client"))
+    return client();
+
+  if(!ecfg.lemem->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/ehal-broker-test.%d", (int)getpid());
+  pid_t broker = fork();
+  if(!broker)
+    _exit(eBrokerServe(&ecfg, path) ? 1 : 0);
+
+  // until it listens
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  strcpy(addr.sun_path, path);
+  int up = 0;
+  for(unsigned i = 0; i < 500 && !up; ++i) {
+    int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    up = !connect(s, (struct sockaddr*)&addr, sizeof(addr));
+    close(s);
+    if(!up)
+      usleep(10000);
+  }
+
+  int ret = !up
+         || lease(path, "0,0,2,2", NULL)                // held until eBrokerRelease()
+         || !lease(path, "1,1,2,2", NULL)               // overlaps
+         || !lease(path, "1,0,4294967295,1", NULL)      // row + rows wraps
+         || !lease(path, "0,4294967295,1,2", NULL)      // col wraps
+         || !lease(path, "2,2,3,1", NULL)               // beyond the chip
+         || !lease(path, "2,2,2,2", "0x80000000");      // beyond the eMem
+  if(ret)
+    printf("broker granted a bogus lease\n");
+  eBrokerRelease();
+
+  if(!ret) {
+    pid_t pid = fork();
+    if(!pid) {
+      setenv("EHAL_BROKER", path, 1);
+      setenv("EHAL_LEASE_CORES", "1,1,2,2", 1);
+      unsetenv("EHAL_LEASE_EMEM");
+      execl("/proc/self/exe", argv[0], "client", (char*)NULL);
+      _exit(127);
+    }
+    int status;
+    ret = waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status);
+    if(ret)
+      printf("leased client failed\n");
+  }
+
+  kill(broker, SIGTERM);
+  waitpid(broker, NULL, 0);
+  unlink(path);
+  if(!ret)
+    printf("broker leases done\n");
+  return ret;
+}
@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ehal.h"
+#include "ehal-copy.h"
+#include "ehal-dma.h"
+
+#define ROUNDS      64
+#define EMEM_BYTES  (1u << 20)
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  X; \
+  gettimeofday(&tend, NULL); \
+  long us = ((tend.tv_sec * 1000000 + tend.tv_usec) \
+             - (tbgn.tv_sec * 1000000 + tbgn.tv_usec)); \
+  printf("%s: measured: %ld μs\n", str, us); \
+  us; \
+})
+
+extern eConfig_t ecfg;
+
+static unsigned char src[EMEM_BYTES + 16];
+
+// every head / tail combination, bytes around the destination untouched
+static int check(volatile unsigned char *dst, size_t room)
+{
+  for(unsigned doff = 0; doff < 8; ++doff)
+    for(unsigned soff = 0; soff < 8; ++soff)
+      for(size_t size = 0; size <= 80 && doff + size + 1 < room; ++size) {
+        for(size_t i = 0; i < size + 16; ++i)
+          dst[i] = 0xEE;
+        eCopy(dst + doff + 1, src + soff, size);
+        for(size_t i = 0; i < size + 16; ++i) {
+          unsigned char want = i > doff && i <= doff + size ? src[soff + i - doff - 1] : 0xEE;
+          if(dst[i] != want) {
+            printf("eCopy dst+%u src+%u size %zu broken at %zu\n", doff + 1, soff, size, i);
+            return -1;
+          }
+        }
+        eFill(dst + doff + 1, 0x5A, size);
+        for(size_t i = 0; i < size + 16; ++i)
+          if(dst[i] != (i > doff && i <= doff + size ? 0x5A : 0xEE)) {
+            printf("eFill dst+%u size %zu broken at %zu\n", doff + 1, size, i);
+            return -1;
+          }
+      }
+
+  // compile time sizes
+  uint64_t v[4] = { 1, 2, 3, 4 };
+  uint32_t w = 0xC0FFEE;
+  eCopy(dst, v, sizeof(v));
+  eCopy(dst + 32, &w, sizeof(w));
+  eFill(dst + 40, 0, 16);
+  return memcmp((void*)dst, v, sizeof(v)) || memcmp((void*)(dst + 32), &w, sizeof(w))
+         || dst[40] || dst[55] ? -1 : 0;
+}
+
+// reads of all alignments, direct and above EDMA_BOUNCE_MIN
+static int checkRead(eCoreMemMap_t *eCore)
+{
+  static unsigned char dst[0x8000 + 16];
+  eCopy(eCore->sram, src, sizeof(eCore->sram));
+  for(unsigned off = 0; off < 8; ++off)
+    for(size_t size = 0; size < 24; ++size) {
+      memset(dst, 0xEE, size + 1);
+      if(eCoreRead(0, 0, off, dst, size) != (ssize_t)size
+         || memcmp(dst, src + off, size) || dst[size] != 0xEE) {
+        printf("eCoreRead +%u size %zu broken\n", off, size);
+        return -1;
+      }
+    }
+  for(unsigned off = 0; off < 8; ++off)
+    if(eCoreRead(0, 0, off + 3, dst + off, sizeof(eCore->sram) - 11) != (ssize_t)sizeof(eCore->sram) - 11
+       || memcmp(dst + off, src + off + 3, sizeof(eCore->sram) - 11)) {
+      printf("eCoreRead large +%u broken\n", off + 3);
+      return -1;
+    }
+  if(eCoreRead(0, 0, 8, dst, sizeof(eCore->sram)) >= 0 || eCoreRead(99, 0, 0, dst, 8) >= 0)
+    return -1;
+
+  // channel setup as the e-lib does, misaligned transfers get rejected
+  eCoreDMA_t *dma = &eCore->regs.dma[EDMA_CHANNEL];
+  if(!eDmaStart(eCore, EDMA_CHANNEL, 0x8e000004, 0x100, 64)
+     || eDmaStart(eCore, EDMA_CHANNEL, 0x8e000000, (uint32_t)(uintptr_t)eCore->sram, 64)
+     || dma->count.inner_count != 8 || dma->count.outer_count != 1
+     || dma->stride != 0x80008 || !dma->config.dmaen || dma->config.datasize != 3
+     || !eDmaStart(eCore, EDMA_CHANNEL, 0x8e000000, 0x100, 64)) // busy
+    return -1;
+  dma->config.reg = 0;
+  return eDmaWait(eCore, EDMA_CHANNEL, 1000);
+}
+
+// scattered, partly overlapping items over all eCores against a model
+// ascending and apart, i.e. the direct path
+static int checkWritevAscending(void)
+{
+  unsigned dim = ecfg.chip[0].xyDim;
+  eWriteVec_t vec[ECORES_MAX_DIM * 8];
+  for(unsigned i = 0; i < dim * dim * 8; ++i) {
+    vec[i] = (eWriteVec_t){ i / 8 / dim, i / 8 % dim, 0x200 + i % 8 * 64, src + i, 1 + i % 60 };
+    eFill(ecfg.chip[0].eCoreRoot[vec[i].row][vec[i].col].sram + vec[i].offset, 0, 64);
+  }
+  if(eCoreWritev(vec, dim * dim * 8) < 0)
+    return -1;
+  for(unsigned i = 0; i < dim * dim * 8; ++i) {
+    const unsigned char *sram = (const unsigned char*)ecfg.chip[0].eCoreRoot[vec[i].row][vec[i].col].sram + vec[i].offset;
+    if(memcmp(sram, vec[i].buf, vec[i].size) || sram[vec[i].size]) {
+      printf("eCoreWritev ascending item %u differs\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int checkWritev(unsigned items, size_t maxSize)
+{
+  unsigned dim = ecfg.chip[0].xyDim;
+  static unsigned char model[ECORES_MAX_DIM][0x8000];
+  eWriteVec_t *vec = malloc(items * sizeof(*vec));
+  if(!vec)
+    return -1;
+
+  for(unsigned c = 0; c < dim * dim; ++c) {
+    eFill(ecfg.chip[0].eCoreRoot[c / dim][c % dim].sram, 0, 0x8000);
+    memset(model[c], 0, 0x8000);
+  }
+  unsigned seed = items;
+  for(unsigned i = 0; i < items; ++i) {
+    seed = seed * 1103515245 + 12345;
+    unsigned core = (seed >> 8) % (dim * dim);
+    size_t size = 1 + (seed >> 16) % maxSize;
+    uint32_t offset = (seed >> 4) % (0x8000 - size);
+    if(i && i % 3 == 0 && vec[i - 1].offset + vec[i - 1].size + size <= 0x8000) {
+      core = vec[i - 1].row * dim + vec[i - 1].col;   // adjoining
+      offset = vec[i - 1].offset + vec[i - 1].size - (i % 2 ? 0 : 1);
+    }
+    vec[i] = (eWriteVec_t){ core / dim, core % dim, offset, src + (seed & 0xFFF), size };
+    memcpy(&model[core][offset], vec[i].buf, size);
+  }
+
+  ssize_t ret = eCoreWritev(vec, items);
+  for(unsigned c = 0; c < dim * dim && ret >= 0; ++c)
+    if(memcmp((void*)ecfg.chip[0].eCoreRoot[c / dim][c % dim].sram, model[c], 0x8000)) {
+      printf("eCoreWritev eCore %u differs\n", c);
+      ret = -1;
+    }
+  eWriteVec_t bad = { 0, 0, 0x7ff0, src, 32 };
+  if(eCoreWritev(&bad, 1) >= 0)
+    ret = -1;
+  free(vec);
+  return ret < 0 ? -1 : 0;
+}
+
+// the emulation has no DMA engine behind the registers, hence solely what
+// the host leaves in them resp. in SRAM gets checked
+static int checkDma(eCoreMemMap_t *eCore)
+{
+  eCoreDMA_t *dma = &eCore->regs.dma[0];
+  eDmaDesc_t desc;
+  if(eDmaDescCopy(&desc, 0x100, 0x200, 64) || desc.config != EDMA_CONFIG_DWORD
+     || desc.count != ((1u << 16) | 8) || desc.inner_stride != EDMA_STRIDE( 8, 8 )
+     || eDmaDescCopy(&desc, 0x102, 0x206, 6) || (desc.config >> 5 & 3) != 1
+     || eDmaDescCopy(&desc, 0x100, 0x200, 0x80000) != -1)
+    return -1;
+
+  // single descriptor, straight into the registers
+  dma->config.reg = 0;
+  if(eDmaMove(eCore, 0, 0x7000, 0x1000, 0x8e000000, 0x4000)
+     || dma->config.reg != EDMA_CONFIG_DWORD || dma->count.reg != ((1u << 16) | 0x800)
+     || dma->srcaddr != 0x8e000000 || dma->dstaddr != 0x1000
+     || eDmaMove(eCore, 0, 0x7000, 0x1000, 0x8e000000, 0x4000) != -1) {  // busy
+    printf("eDmaMove into registers failed\n");
+    return -1;
+  }
+
+  // byte head, double word body, word tail, chained in SRAM
+  dma->config.reg = 0;
+  eDmaDesc_t chain[EDMA_MOVE_DESCS];
+  if(eDmaMove(eCore, 0, 0x7000, 0x1003, 0x8e000003, 0x4001)
+     || dma->config.reg != (EDMA_CONFIG_NEXT( 0x7000 ) | EDMA_CONFIG_STARTUP))
+    return -1;
+  eCopyFrom(chain, &eCore->sram[0x7000], sizeof(chain));
+  dma->config.reg = 0;
+  if(chain[0].config != (EDMA_CONFIG_NEXT( 0x7018 ) | EDMA_CONFIG_CHAIN | EDMA_CONFIG_ENABLE | EDMA_CONFIG_MASTER)
+     || chain[0].count != ((1u << 16) | 5) || chain[0].src_addr != 0x8e000003
+     || chain[1].config != (EDMA_CONFIG_NEXT( 0x7030 ) | EDMA_CONFIG_CHAIN | EDMA_CONFIG_DWORD)
+     || chain[1].count != ((1u << 16) | 0x7FF) || chain[1].dst_addr != 0x1008
+     || chain[2].config != (EDMA_CONFIG_ENABLE | EDMA_CONFIG_MASTER | EDMA_CONFIG_SIZE( 2 ))
+     || chain[2].count != ((1u << 16) | 1) || chain[2].src_addr != 0x8e004000) {
+    printf("eDmaMove chain differs\n");
+    return -1;
+  }
+
+  // busy channel, the descriptors it may still fetch stay as they are
+  dma->config.reg = EDMA_CONFIG_DWORD;
+  if(eDmaMove(eCore, 0, 0x7000, 0x1005, 0x8e000005, 0x2001) != -1
+     || memcmp((void*)&eCore->sram[0x7000], chain, sizeof(chain))) {
+    printf("eDmaMove overwrote the chain of a busy channel\n");
+    return -1;
+  }
+  dma->config.reg = 0;
+
+  // 1MB from eMem to eMem, rows of 0x8000 double words
+  if(eCoreDmaMove(1, 1, 0, 0x7000, 0x8e100000, 0x8e000000, 0x100000)
+     || dma->config.reg != (EDMA_CONFIG_NEXT( 0x7000 ) | EDMA_CONFIG_STARTUP))
+    return -1;
+  eCopyFrom(chain, &eCore->sram[0x7000], sizeof(chain[0]));
+  dma->config.reg = 0;
+  return chain[0].count == ((4u << 16) | 0x8000) && chain[0].outer_stride == EDMA_STRIDE( 8, 8 )
+         && !(chain[0].config & EDMA_CONFIG_CHAIN) && !eCoreDmaWait(1, 1, 0) ? 0 : -1;
+}
+
+static int checkTile(unsigned row, unsigned col, unsigned rows, unsigned cols,
+                     unsigned tileRows, unsigned tileCols, unsigned elem, size_t pad)
+{
+  size_t line = (size_t)tileCols * elem, stride = line * cols + pad;
+  eTile_t tile = { row, col, rows, cols, 0x2000, tileRows, tileCols, elem,
+                   pad ? stride : 0, 1, 0x1000 };
+  const unsigned char *matrix = src + 3;
+  if(eCoreTileScatter(&tile, matrix) != (ssize_t)(line * tileRows * rows * cols))
+    return -1;
+  for(unsigned r = 0; r < rows; ++r)
+    for(unsigned c = 0; c < cols; ++c)
+      for(unsigned i = 0; i < tileRows; ++i)
+        if(memcmp((void*)&ecfg.chip[0].eCoreRoot[row + r][col + c].sram[0x2000 + i * line],
+                  matrix + (r * tileRows + i) * stride + c * line, line)) {
+          printf("eCoreTileScatter eCore (%u,%u) row %u differs\n", row + r, col + c, i);
+          return -1;
+        }
+
+  size_t bytes = stride * rows * tileRows;
+  unsigned char *back = calloc(1, bytes);
+  if(!back || eCoreTileGather(&tile, back) != (ssize_t)(line * tileRows * rows * cols))
+    return -1;
+  int ret = 0;
+  for(size_t i = 0; i < bytes && !ret; ++i)
+    if(back[i] != (i % stride < line * cols ? matrix[i] : 0)) {
+      printf("eCoreTileGather differs at %zu\n", i);
+      ret = -1;
+    }
+  free(back);
+
+  eTile_t bad = tile;
+  bad.offset = 0x8000 - line * tileRows + 1;
+  if(eCoreTileScatter(&bad, matrix) >= 0)
+    ret = -1;
+  return ret;
+}
+
+// relaxed bulk stores, directly and with the write-combined aperture open,
+// visible once the control write after the fence is. ARMv7 refuses the
+// aperture, the case is skipped there.
+static int checkRelaxed(eCoreMemMap_t *eCore, volatile unsigned char *dst, size_t size)
+{
+  for(int aperture = 0; aperture < 2; ++aperture) {
+    if(aperture && !eShmApertureOpen(ESHM_WRITECOMBINE))
+      break;
+    for(unsigned off = 0; off < 8; ++off) {
+      memset((void*)dst, 0xEE, size);
+      eMemStoreRelaxed(dst + off, src + aperture, size - 8);
+      eStoreOrdered(&eCore->regs.debug.reg, aperture);
+      if(memcmp((void*)(dst + off), src + aperture, size - 8)
+         || dst[off + size - 8] != 0xEE || eCore->regs.debug.reg != (uint32_t)aperture) {
+        printf("eMemStoreRelaxed %s +%u broken\n", aperture ? "aperture" : "direct", off);
+        eShmApertureClose();
+        return -1;
+      }
+    }
+  }
+  eShmApertureClose();
+  return 0;
+}
+
+int main(void)
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+  for(size_t i = 0; i < sizeof(src); ++i)
+    src[i] = (unsigned char)(i * 13 + (i >> 8));
+
+  eCoreMemMap_t *eCore = &ecfg.chip[0].eCoreRoot[0][0];
+  eMemPtr_t emem = eMemAlloc(EMEM_BYTES);
+  if(!emem.host
+     || check(eCore->sram, sizeof(eCore->sram))
+     || check(emem.host, EMEM_BYTES)
+     || checkRead(eCore)
+     || checkDma(&ecfg.chip[0].eCoreRoot[1][1])
+     || checkRelaxed(eCore, emem.host, 0x3000)
+     || checkWritevAscending()
+     || checkWritev(1000, 64)           // kernel arguments
+     || checkWritev(200, 2048)          // pipelined
+     || checkTile(0, 0, ecfg.chip[0].xyDim, ecfg.chip[0].xyDim, 32, 32, 4, 0)
+     || checkTile(1, 1, 2, 3, 7, 5, 3, 40)      // odd rows, padded matrix
+     || checkTile(0, 2, 1, 2, 64, 128, 1, 0)    // tiles beyond the stage
+     || checkTile(2, 0, 1, 1, 2, 0x1400, 1, 8)) // rows beyond the stage
+    return 1;
+
+  long mc = MEASURE( "memcpy to SRAM", for(unsigned r = 0; r < ROUNDS * 32; ++r)
+                       memcpy((void*)eCore->sram, src + (r & 7), sizeof(eCore->sram)) );
+  long ec = MEASURE( "eCopy to SRAM", for(unsigned r = 0; r < ROUNDS * 32; ++r)
+                       eCopy(eCore->sram, src + (r & 7), sizeof(eCore->sram)) );
+  printf("SRAM: eCopy %.1fx of memcpy\n", ec ? (double)mc / ec : 0.0);
+
+  mc = MEASURE( "memcpy to eMem", for(unsigned r = 0; r < ROUNDS; ++r)
+                  memcpy(emem.host, src + (r & 7), EMEM_BYTES) );
+  ec = MEASURE( "eCopy to eMem", for(unsigned r = 0; r < ROUNDS; ++r)
+                  eCopy(emem.host, src + (r & 7), EMEM_BYTES) );
+  printf("eMem: eCopy %.1fx of memcpy\n", ec ? (double)mc / ec : 0.0);
+
+  // 8 byte arguments to every eCore, single writes vs. one vector
+  unsigned dim = ecfg.chip[0].xyDim;
+  eWriteVec_t args[ECORES_MAX_DIM * 8];
+  for(unsigned i = 0; i < dim * dim * 8; ++i)
+    args[i] = (eWriteVec_t){ i / 8 / dim, i / 8 % dim, 0x100 + (7 - i % 8) * 8, src + i * 8, 8 };
+  mc = MEASURE( "single writes of arguments", for(unsigned r = 0; r < ROUNDS * 16; ++r)
+                  for(unsigned i = 0; i < dim * dim * 8; ++i)
+                    memcpy((void*)&ecfg.chip[0].eCoreRoot[args[i].row][args[i].col].sram[args[i].offset],
+                           args[i].buf, args[i].size) );
+  ec = MEASURE( "eCoreWritev of arguments", for(unsigned r = 0; r < ROUNDS * 16; ++r)
+                  eCoreWritev(args, dim * dim * 8) );
+  printf("arguments: eCoreWritev %.1fx of single writes\n", ec ? (double)mc / ec : 0.0);
+
+  // the same in ascending order, as a launcher usually lays them out
+  for(unsigned i = 0; i < dim * dim * 8; ++i)
+    args[i].offset = 0x100 + i % 8 * 8;
+  mc = MEASURE( "single writes of ascending arguments", for(unsigned r = 0; r < ROUNDS * 16; ++r)
+                  for(unsigned i = 0; i < dim * dim * 8; ++i)
+                    memcpy((void*)&ecfg.chip[0].eCoreRoot[args[i].row][args[i].col].sram[args[i].offset],
+                           args[i].buf, args[i].size) );
+  ec = MEASURE( "eCoreWritev of ascending arguments", for(unsigned r = 0; r < ROUNDS * 16; ++r)
+                  eCoreWritev(args, dim * dim * 8) );
+  printf("ascending arguments: eCoreWritev %.1fx of single writes\n", ec ? (double)mc / ec : 0.0);
+
+  if(memcmp(emem.host, src + ((ROUNDS - 1) & 7), EMEM_BYTES))
+    return 1;
+  eMemFree(emem.host);
+  return 0;
+}
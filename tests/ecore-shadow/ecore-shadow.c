@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <stdio.h>
+#include "ehal.h"
+#include "ehal-shadow.h"
+
+#define LPMODE  (1u << 22)
+
+extern eConfig_t ecfg;
+
+// the emulated registers are plain memory, hence writes behind the shadow's
+// back show whether the register got read
+static int checkShadow(eCoreMemMap_t *eCore)
+{
+  if(EREG_FIELD_MASK( eCore->regs.config, lpmode ) != LPMODE
+     || EREG_FIELD_BITS( eCore->regs.dma[0].config, datasize, 3 ) != (3u << 5)) {
+    printf("field masks broken\n");
+    return -1;
+  }
+
+  eRegForgetCore(eCore);
+  eCore->regs.config.reg = 0x5;
+  if(eRegLoad(&eCore->regs.config.reg) != 0x5)
+    return -1;
+  eCore->regs.config.reg = 0x7;         // not seen from now on
+  eRegSetField( eCore->regs.config, lpmode, 1 );
+  if(eCore->regs.config.reg != (0x5 | LPMODE) || eRegLoad(&eCore->regs.config.reg) != (0x5 | LPMODE)) {
+    printf("config update read the register\n");
+    return -1;
+  }
+  eCore->regs.config.reg = 0x7;
+  eRegForget(&eCore->regs.config.reg);
+  if(eRegLoad(&eCore->regs.config.reg) != 0x7)
+    return -1;
+
+  // registers without shadow pass through
+  eCore->regs.r[5] = 0xF0;
+  eRegUpdate(&eCore->regs.r[5], 0x0F, 0x05);
+  return eCore->regs.r[5] == 0xF5 ? 0 : -1;
+}
+
+static int checkBatch(void)
+{
+  eCoreMemMap_t *a = &ecfg.chip[0].eCoreRoot[3][3], *b = &ecfg.chip[0].eCoreRoot[0][1];
+  eRegWrite_t buf[4];
+  eRegBatch_t batch = EREG_BATCH_INIT( buf );
+
+  eRegForgetCore(a);
+  a->regs.imask = 0x3;
+  a->regs.r[1] = 0xF0;
+  eRegBatchStore(&batch, &a->regs.r[1], 0xA0);
+  eRegBatchStore(&batch, &b->regs.r[1], 1);
+  eRegBatchUpdate(&batch, &a->regs.r[1], 0x0F, 0x0B);  // sees the queued value
+  eRegBatchUpdate(&batch, &a->regs.imask, 0x4, 0x4);
+  if(a->regs.r[1] != 0xF0 || a->regs.imask != 0x3)     // nothing left yet
+    return -1;
+  eRegBatchStore(&batch, &b->regs.r[2], 2);             // full, flushes
+
+  // by eCore, in program order per eCore, buf[0] got queued anew
+  if(b->regs.r[1] != 1 || buf[1].reg != &a->regs.r[1] || buf[2].reg != &a->regs.r[1]
+     || buf[3].reg != &a->regs.imask || buf[0].reg != &b->regs.r[2] || batch.n != 1) {
+    printf("batch not ordered by eCore\n");
+    return -1;
+  }
+  eRegBatchFlush(&batch);
+  return a->regs.r[1] == 0xAB && a->regs.imask == 0x7 && b->regs.r[1] == 1
+         && b->regs.r[2] == 2 && eRegLoad(&a->regs.imask) == 0x7 ? 0 : -1;
+}
+
+int main(void)
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+  if(checkShadow(&ecfg.chip[0].eCoreRoot[2][1])
+     || checkBatch())
+    return 1;
+  return 0;
+}
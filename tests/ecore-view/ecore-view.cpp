@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <cstdio>
+#include <cstring>
+#include "ehal-view.hpp"
+
+// as an eCore kernel lays out its arguments
+struct Args {
+  std::uint32_t count;
+  std::uint32_t in, out;            // eMem addresses
+  float scale;
+};
+
+int main()
+{
+  extern eConfig_t ecfg;
+  if(!ecfg.lemem->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  // C view, in place in the SRAM of eCore (1,2)
+  eView_t c = eCoreView(1, 2, 0x2000, 4 * sizeof(Args));
+  eCoreMemMap_t *eCore = &ecfg.lchip->eCoreRoot[1][2];
+  if(c.base != (void*)&eCore->sram[0x2000] || eViewCount( c, Args ) != 4
+     || eCoreView(1, 2, 0x7FF0, 0x20).base || eCoreView(ecfg.lchip->xyDim, 0, 0, 4).base) {
+    printf("eCoreView broken\n");
+    return 1;
+  }
+  eViewAt( c, Args, 3 ).count = 7;
+  eViewAt( eViewSub(c, sizeof(Args), sizeof(Args)), volatile std::uint32_t, 1 ) = 0xC0FFEE;
+
+  // C++ view of the same bytes
+  auto args = ehal::coreView<Args>(1, 2, 0x2000, 4);
+  if(args.size() != 4 || args.eaddr() != eViewEpi(c)
+     || args[3].count != 7 || args[1].in != 0xC0FFEE) {
+    printf("coreView broken\n");
+    return 1;
+  }
+
+  // eMem buffer, linked from the arguments by its eCore address
+  eMemPtr_t buf = eMemAlloc(1000 * sizeof(float));
+  auto in = ehal::memView<float>(buf.host, 1000);
+  for(std::size_t i = 0; i < in.size(); ++i)
+    in[i] = i * 0.5f;
+  args.front() = Args{ static_cast<std::uint32_t>(in.size()), in.eaddr(), 0, 2.0f };
+
+  float sum = 0;
+  for(float f : in.subview(10, 10))
+    sum += f;
+  Args a0 = args[0];
+  if(in.eaddr() != buf.eaddr || a0.in != buf.eaddr || a0.count != 1000
+     || in.last(1)[0] != 499.5f || sum != 72.5f
+     || !ehal::memView<float>(buf.host, (ecfg.lemem->size >> 2) + 1).empty()
+     || !ehal::memView<double>(static_cast<char*>(buf.host) + 4, 1).empty()) {
+    printf("memView broken\n");
+    return 1;
+  }
+  eMemFree(buf.host);
+
+  printf("views done\n");
+  return 0;
+}
@@ -0,0 +1,357 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "ehal.h"
+
+extern eConfig_t ecfg;
+
+#define LIVE    2048
+#define ROUNDS  64
+#define THREADS 4
+#define WORKSET 16
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  X; \
+  gettimeofday(&tend, NULL); \
+  long us = ((tend.tv_sec * 1000000 + tend.tv_usec) \
+           - (tbgn.tv_sec * 1000000 + tbgn.tv_usec)); \
+  printf("%s: measured: %ld μs\n", str, us); \
+  us; \
+})
+
+static size_t sizes[LIVE];
+static unsigned order[LIVE];
+static void *ptrs[LIVE];
+
+static size_t alignOf(size_t size)
+{
+  return size <= 32 ? 8 : size <= 2048 ? 64 : 4096;
+}
+
+static int check(void)
+{
+  eConfigMem_t *emem = ecfg.lemem;
+  for(unsigned i = 0; i < LIVE; ++i) {
+    eMemPtr_t p = eMemAlloc(sizes[i]);
+    if(!p.host
+       || ((uintptr_t)p.host & (alignOf(sizes[i]) - 1))
+       || (char*)p.host < emem->epi_base
+       || (char*)p.host + sizes[i] > emem->epi_base + emem->size
+       || eMemEpiToHost(emem, p.eaddr) != p.host) {
+      printf("bad allocation %u: %zu bytes at %p (0x%08x)\n", i, sizes[i], p.host, p.eaddr);
+      return -1;
+    }
+    ptrs[i] = p.host;
+    memset(p.host, i & 0xFF, sizes[i]);
+  }
+  // no two live allocations overlap
+  for(unsigned i = 0; i < LIVE; ++i)
+    for(size_t b = 0; b < sizes[i]; ++b)
+      if(((unsigned char*)ptrs[i])[b] != (i & 0xFF)) {
+        printf("allocation %u got overwritten\n", i);
+        return -1;
+      }
+  for(unsigned i = 0; i < LIVE; ++i)
+    eMemFree(ptrs[order[i]]);
+  return 0;
+}
+
+static int checkReserve(void)
+{
+  eConfigMem_t *emem = ecfg.lemem;
+
+  // heap is idle, hence it gets moved away from the legacy offsets
+  eMemPtr_t low = eMemReserve(0x0, 0x2000);
+  eMemPtr_t high = eMemReserve(0x01000000, 0x10000);
+  if(low.host != emem->epi_base || high.host != emem->epi_base + 0x01000000
+     || eMemHostToEpi(emem, high.host) != high.eaddr) {
+    printf("reservation not at its offset\n");
+    return -1;
+  }
+  if(eMemReserve(0x1000, 0x1000).host) {
+    printf("overlapping reservation accepted\n");
+    return -1;
+  }
+
+  eMemPtr_t p = eMemAlloc(64);
+  uint32_t off = (uint32_t)((char*)p.host - emem->epi_base);
+  if(!p.host || off < 0x2000 || (off >= 0x01000000 && off < 0x01010000)) {
+    printf("heap allocation within a reservation\n");
+    return -1;
+  }
+  // live buffer within the heap
+  if(eMemReserve(off & ~0xFFFu, 0x1000).host) {
+    printf("reservation over live heap buffer accepted\n");
+    return -1;
+  }
+  // the region area is no matter of the heap
+  eMemPtr_t area = eMemReserve(0x01800000, 0x1000);
+  if(area.host != emem->epi_base + 0x01800000 || eMemRelease(0x01800000)) {
+    printf("reservation within the region area refused\n");
+    return -1;
+  }
+  eMemFree(p.host);
+
+  if(eMemRelease(0x0) || eMemRelease(0x01000000) || !eMemRelease(0x0)) {
+    printf("release failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+static volatile int rebuilding;
+
+static void* threadRebuild(void *arg)
+{
+  (void)arg;
+  unsigned bad = 0;
+  while(rebuilding) {
+    unsigned char *p = eMemAlloc(64).host;
+    if(!p)
+      continue;
+    memset(p, 0xA5, 64);
+    sched_yield();
+    for(unsigned b = 0; b < 64; ++b)
+      bad += p[b] != 0xA5;
+    eMemFree(p);
+  }
+  return (void*)(uintptr_t)bad;
+}
+
+// reservations over the heap, i.e. rebuilds, while another thread allocates
+static int checkRebuild(void)
+{
+  pthread_t th;
+  void *bad;
+  rebuilding = 1;
+  if(pthread_create(&th, NULL, threadRebuild, NULL))
+    return -1;
+  for(unsigned i = 0; i < 8; ++i) {
+    eMemPtr_t low = eMemReserve(0x0, 0x2000);
+    if(low.host) {
+      memset(low.host, 0x5A, 0x2000);
+      eMemRelease(0x0);
+    }
+    sched_yield();
+  }
+  rebuilding = 0;
+  pthread_join(th, &bad);
+  if(bad) {
+    printf("heap rebuilt beneath a live allocation\n");
+    return -1;
+  }
+  return 0;
+}
+
+static int checkStats(void)
+{
+  eMemStats_t bgn, end;
+  eMemTrace_t trace[4];
+  if(eMemTraceStart(256) || eMemStats(&bgn))
+    return -1;
+
+  eMemPtr_t small = eMemAlloc(100), large = eMemAlloc(1 << 20);
+  eMemStats(&end);
+  eMemFree(small.host);
+  eMemFree(large.host);
+  eMemTraceStop();
+
+  // the small block went to this thread's cache
+  eMemStats_t freed;
+  if(eMemStats(&freed)
+     || freed.cachedBytes < 128
+     || freed.liveBytes + 128 + (1 << 20) > end.liveBytes
+     || freed.allocs < bgn.allocs + 2 || freed.frees < bgn.frees + 2
+     || !eMemTraceStart(512)) {
+    printf("cached blocks counted as live, own calls uncounted resp. trace resized\n");
+    eStatsPrint(stdout, &freed);
+    return -1;
+  }
+
+  if(end.heapSize + end.regionBytes != ecfg.lemem->size || !end.regionBytes
+     || end.liveBytes < bgn.liveBytes + (1 << 20)
+     || end.peakBytes < end.liveBytes
+     || end.largestFree > end.mspaceFree
+     || end.fragmentation < 0.0 || end.fragmentation > 1.0) {
+    printf("implausible heap statistics\n");
+    eStatsPrint(stdout, &end);
+    return -1;
+  }
+
+  if(eMemTraceRead(trace, 4) != 4
+     || trace[0].eaddr != small.eaddr || trace[0].size != 100
+     || trace[1].eaddr != large.eaddr || trace[1].size != 1 << 20
+     || trace[2].eaddr != small.eaddr || trace[2].size >= 0
+     || trace[3].ns < trace[0].ns) {
+    printf("allocation trace mismatch\n");
+    return -1;
+  }
+  eMemStatsPrint(stdout);
+  return 0;
+}
+
+typedef struct {
+  uint32_t value;
+  eRel_t next;
+} node_t;
+
+static int checkArena(void)
+{
+  eConfigMem_t *emem = ecfg.lemem;
+  eArena_t *arena = eMemArenaCreate(0x4000);
+  if(!arena)
+    return -1;
+
+  // list 0 -> 1 -> ... -> 99
+  eRel_t head = 0, *link = &head;
+  for(uint32_t i = 0; i < 100; ++i) {
+    eRel_t rel = eArenaNew(arena, node_t);
+    node_t *n = eArenaGet(arena, rel, node_t);
+    if(!n) {
+      printf("arena exhausted early\n");
+      return -1;
+    }
+    n->value = i;
+    n->next = 0;
+    *link = rel;
+    link = &n->next;
+  }
+
+  // walk it the way an eCore does, from another base: the host maps eMem at
+  // the Epiphany addresses, hence a copy stands in for the eCore's view
+  eArena_t *epiView = malloc(arena->size);
+  if(!epiView)
+    return -1;
+  memcpy(epiView, arena, arena->used);
+  uint32_t i = 0;
+  for(eRel_t rel = head; rel; rel = eArenaGet(epiView, rel, node_t)->next, ++i) {
+    node_t *n = eArenaGet(epiView, rel, node_t);
+    if(n->value != i
+       || (char*)n != (char*)epiView + rel
+       || eArenaToEpi(epiView, rel) != eArenaToEpi(arena, rel)
+       || eMemEpiToHost(emem, eArenaToEpi(arena, rel)) != eArenaAt(arena, rel, node_t)) {
+      printf("arena list broken at %u\n", i);
+      free(epiView);
+      return -1;
+    }
+  }
+  free(epiView);
+  if(i != 100
+     || eArenaValid(arena, arena->used, sizeof(node_t))
+     || eArenaValid(arena, 0, sizeof(node_t))
+     || eArenaAlloc(arena, 0x4000, 8)) {
+    printf("arena validation failed\n");
+    return -1;
+  }
+  eMemArenaDestroy(arena);
+  return 0;
+}
+
+static void benchSlab(void)
+{
+  for(unsigned r = 0; r < ROUNDS; ++r) {
+    for(unsigned i = 0; i < LIVE; ++i)
+      ptrs[i] = eMemAlloc(sizes[i]).host;
+    for(unsigned i = 0; i < LIVE; ++i)
+      eMemFree(ptrs[order[i]]);
+  }
+}
+
+static void benchMspace(void)
+{
+  for(unsigned r = 0; r < ROUNDS; ++r) {
+    for(unsigned i = 0; i < LIVE; ++i)
+      ptrs[i] = mspace_malloc(ecfg.lemem->space, sizes[i]);
+    for(unsigned i = 0; i < LIVE; ++i)
+      mspace_free(ecfg.lemem->space, ptrs[order[i]]);
+  }
+}
+
+static void* threadSlab(void *arg)
+{
+  // short lived buffers, a handful in flight per thread
+  unsigned t = (unsigned)(uintptr_t)arg;
+  void *own[WORKSET];
+  for(unsigned r = 0; r < ROUNDS * (LIVE / THREADS / WORKSET); ++r) {
+    for(unsigned i = 0; i < WORKSET; ++i)
+      own[i] = eSlabAlloc(ecfg.lemem, sizes[(t * WORKSET + r + i) % LIVE]).host;
+    for(unsigned i = 0; i < WORKSET; ++i)
+      eSlabFree(ecfg.lemem, own[i]);
+  }
+  return NULL;
+}
+
+static void* threadTcache(void *arg)
+{
+  // short lived buffers, a handful in flight per thread
+  unsigned t = (unsigned)(uintptr_t)arg;
+  void *own[WORKSET];
+  for(unsigned r = 0; r < ROUNDS * (LIVE / THREADS / WORKSET); ++r) {
+    for(unsigned i = 0; i < WORKSET; ++i)
+      own[i] = eMemAlloc(sizes[(t * WORKSET + r + i) % LIVE]).host;
+    for(unsigned i = 0; i < WORKSET; ++i)
+      eMemFree(own[i]);
+  }
+  return NULL;
+}
+
+static void benchThreads(void* (*fnc)(void*))
+{
+  pthread_t th[THREADS];
+  for(unsigned t = 0; t < THREADS; ++t)
+    pthread_create(&th[t], NULL, fnc, (void*)(uintptr_t)t);
+  for(unsigned t = 0; t < THREADS; ++t)
+    pthread_join(th[t], NULL);
+}
+
+int main(void)
+{
+  if(!ecfg.lemem->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  // mostly small DMA buffers, some pages
+  srand(42);
+  for(unsigned i = 0; i < LIVE; ++i) {
+    unsigned r = rand();
+    sizes[i] = (r & 0x7) ? 1 + (r >> 3) % 2048 : 1 + (r >> 3) % 16384;
+    order[i] = i;
+  }
+  for(unsigned i = LIVE - 1; i > 0; --i) {
+    unsigned j = rand() % (i + 1), t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+
+  if(check() || checkReserve() || check() || checkRebuild() || checkStats() || checkArena())
+    return 1;
+
+  long mspace = MEASURE( "mspace_malloc/free", benchMspace() );
+  long slab = MEASURE( "eMemAlloc/eMemFree", benchSlab() );
+  printf("%u x %u alloc/free: slab %.1fx of mspace\n", ROUNDS, LIVE,
+         slab ? (double)mspace / slab : 0.0);
+
+  long central = MEASURE( "eSlabAlloc/eSlabFree (threads)", benchThreads(threadSlab) );
+  long cached = MEASURE( "eMemAlloc/eMemFree (threads)", benchThreads(threadTcache) );
+  // the lock of the central slab solely gets contended with several CPUs,
+  // on a single one the ratio merely shows the overhead of the caches
+  printf("%u threads on %ld CPUs: thread cache %.1fx of central slab\n", THREADS,
+         sysconf(_SC_NPROCESSORS_ONLN), cached ? (double)central / cached : 0.0);
+
+  // all caches got returned on thread exit, the heap is reusable at once
+  if(check())
+    return 1;
+  return 0;
+}
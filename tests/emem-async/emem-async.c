@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ehal.h"
+#include "ehal-copy.h"
+
+#define CHUNK       (1u << 20)
+#define CHUNKS      8
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  X; \
+  gettimeofday(&tend, NULL); \
+  long us = ((tend.tv_sec * 1000000 + tend.tv_usec) \
+             - (tbgn.tv_sec * 1000000 + tbgn.tv_usec)); \
+  printf("%s: measured: %ld μs\n", str, us); \
+  us; \
+})
+
+extern eConfig_t ecfg;
+
+static unsigned char src[CHUNKS][CHUNK];
+static volatile double sink;
+
+// backend counting what it got handed, copying like memcpy
+static unsigned long bulkBytes;
+static int bulkOpen(void) { return 0; }
+static void bulkClose(void) { }
+static int bulkCopy(volatile void *dst, const volatile void *src, size_t size, eBulkDir_t dir)
+{
+  __atomic_add_fetch(&bulkBytes, size, __ATOMIC_RELAXED);
+  return eBulkMemcpy.copy(dst, src, size, dir);
+}
+static const eBulkBackend_t bulkCounting = { "counting", bulkOpen, bulkClose, bulkCopy };
+
+// backend whose device is missing
+static int bulkMissingOpen(void) { return -1; }
+static const eBulkBackend_t bulkMissing = { "missing", bulkMissingOpen, bulkClose, bulkCopy };
+
+// stand-in for host work overlapping with the transfers
+static void compute(void)
+{
+  double acc = 0;
+  for(unsigned i = 0; i < 4000000; ++i)
+    acc += i * 0.5;
+  sink = acc;
+}
+
+int main(void)
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+  for(unsigned c = 0; c < CHUNKS; ++c)
+    memset(src[c], c + 1, CHUNK);
+
+  eMemPtr_t buf = eMemAlloc(CHUNKS * CHUNK);
+  if(!buf.host)
+    return 1;
+
+  // memcpy by default, the fallback if a backend does not open, e.g. pl330
+  // without its driver in the emulation
+  if(eBulkCurrent() != &eBulkMemcpy || eBulkUse(&bulkMissing) != -1
+     || eBulkUse(&eBulkPl330) != -1 || eBulkCurrent() != &eBulkMemcpy
+     || eBulkCurrent() != &eBulkMemcpy || eBulkUse(&bulkCounting)) {
+    printf("bulk backend selection failed\n");
+    return 1;
+  }
+
+  // batch of writes into eMem, completion by eventfd
+  eXfer_t *xfer[CHUNKS];
+  for(unsigned c = 0; c < CHUNKS; ++c)
+    if(!(xfer[c] = eXferWrite((char*)buf.host + c * CHUNK, src[c], CHUNK)))
+      return 1;
+  int fd = eXferFd(xfer[CHUNKS - 1]);
+  if(fd < 0 || eXferSubmit(xfer, CHUNKS))
+    return 1;
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  if(poll(&pfd, 1, 5000) != 1 || !eXferPoll(xfer[CHUNKS - 1]))
+    return 1;
+  for(unsigned c = 0; c < CHUNKS; ++c) {
+    if(eXferWait(xfer[c]) != CHUNK || ((unsigned char*)buf.host)[c * CHUNK + 7] != c + 1)
+      return 1;
+    eXferFree(xfer[c]);
+  }
+  // solely the bulk transfers go through the backend
+  unsigned char small[64];
+  if(bulkBytes != CHUNKS * CHUNK || eBulkRead(small, buf.host, sizeof(small)) != sizeof(small)
+     || bulkBytes != CHUNKS * CHUNK || small[7] != 1) {
+    printf("bulk backend bypassed\n");
+    return 1;
+  }
+
+  // SRAM write, read back, and a vector
+  eCoreMemMap_t *eCore = &ecfg.chip[0].eCoreRoot[1][2];
+  unsigned char back[0x1000];
+  eXfer_t *w = eXferWrite(eCore->sram + 0x100, src[3], sizeof(back));
+  eXfer_t *r = eXferRead(back, eCore->sram + 0x100, sizeof(back));
+  eWriteVec_t vec[2] = { { 0, 0, 0x10, src[4], 8 }, { 3, 3, 0x20, src[5], 8 } };
+  eXfer_t *v = eXferWritev(vec, 2);
+  eXfer_t *batch[] = { w, r, v };
+  if(!w || !r || !v || eXferSubmit(batch, 3)
+     || eXferWait(w) != sizeof(back) || eXferWait(r) != sizeof(back)
+     || eXferWait(v) != 16 || memcmp(back, src[3], sizeof(back))
+     || ecfg.chip[0].eCoreRoot[3][3].sram[0x20] != 6) {
+    printf("SRAM transfers failed\n");
+    return 1;
+  }
+  eXferFree(w);
+  eXferFree(r);
+  eXferFree(v);
+
+  // a handle asked for its eventfd after completion is readable at once,
+  // waiting for it unsubmitted fails instead of blocking
+  eXfer_t *late = eXferWrite(buf.host, src[0], 64);
+  if(!late || eXferWait(late) != -1 || eXferSubmit(&late, 1) || eXferWait(late) != 64)
+    return 1;
+  pfd.fd = eXferFd(late);
+  if(poll(&pfd, 1, 0) != 1)
+    return 1;
+  eXferFree(late);
+
+  long serial = MEASURE( "transfers then compute",
+    for(unsigned c = 0; c < CHUNKS; ++c)
+      eCopy((char*)buf.host + c * CHUNK, src[c], CHUNK);
+    compute() );
+  long overlap = MEASURE( "transfers during compute",
+    for(unsigned c = 0; c < CHUNKS; ++c)
+      xfer[c] = eXferWrite((char*)buf.host + c * CHUNK, src[c], CHUNK);
+    eXferSubmit(xfer, CHUNKS);
+    compute();
+    for(unsigned c = 0; c < CHUNKS; ++c)
+      eXferFree(xfer[c]) );
+  printf("overlap %.1fx of serial\n", overlap ? (double)serial / overlap : 0.0);
+
+  eMemFree(buf.host);
+  return 0;
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ehal.h"
+#include "loader/ehal-data-loader.h"
+
+#define DATASET     ((8u << 20) + 123)  // unaligned tail
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  ssize_t ret = X; \
+  gettimeofday(&tend, NULL); \
+  printf("%s: measured: %ld μs\n", \
+         str, \
+         ((tend.tv_sec * 1000000 + tend.tv_usec) \
+         - (tbgn.tv_sec * 1000000 + tbgn.tv_usec))); \
+  ret; \
+})
+
+int main(int argc, char* argv[])
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  char in[512], out[512];
+  snprintf(in, sizeof(in), "%s/emem-file.in", argc > 1 ? argv[1] : ".");
+  snprintf(out, sizeof(out), "%s/emem-file.out", argc > 1 ? argv[1] : ".");
+
+  unsigned char *ref = malloc(DATASET);
+  FILE *f = fopen(in, "wb");
+  if(!ref || !f)
+    return 1;
+  for(unsigned i = 0; i < DATASET; ++i)
+    ref[i] = (unsigned char)(i * 7 + (i >> 12));
+  fwrite(ref, 1, DATASET, f);
+  fclose(f);
+  remove(out);
+
+  eMemPtr_t buf = eMemAlloc(DATASET);
+  if(!buf.host)
+    return 1;
+
+  if(MEASURE( "load_data 8 MB", load_data(in, 0, buf.host, 0) ) != DATASET
+     || memcmp(buf.host, ref, DATASET)) {
+    printf("load_data mismatch\n");
+    return 1;
+  }
+
+  if(MEASURE( "store_data 8 MB", store_data(out, 0, buf.host, DATASET) ) != DATASET) {
+    printf("store_data failed\n");
+    return 1;
+  }
+
+  // background: partial file at an offset into an offset of the buffer,
+  // the caller's name need not outlive the start
+  char name[sizeof(out)];
+  strcpy(name, out);
+  memset(buf.host, 0, DATASET);
+  edata_job_t *job = load_data_async(name, 4096, (char*)buf.host + 64, 1 << 20);
+  memset(name, 0, sizeof(name));
+  if(data_wait(job) != 1 << 20
+     || memcmp((char*)buf.host + 64, ref + 4096, 1 << 20)) {
+    printf("load_data_async mismatch\n");
+    return 1;
+  }
+
+  eMemFree(buf.host);
+  free(ref);
+  remove(in);
+  remove(out);
+  return 0;
+}
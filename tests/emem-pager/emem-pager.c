@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ehal.h"
+#include "ehal-pager.h"
+
+// dataset beyond the 32 MB eMem window
+#define DATASET     (40u << 20)
+#define PAGE        (256u << 10)
+#define SLOTS       16
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  int ret = X; \
+  gettimeofday(&tend, NULL); \
+  printf("%s: measured: %ld μs\n", \
+         str, \
+         ((tend.tv_sec * 1000000 + tend.tv_usec) \
+         - (tbgn.tv_sec * 1000000 + tbgn.tv_usec))); \
+  ret; \
+})
+
+static uint32_t *data;
+
+// the eCores' part, here: sum up and increment each word
+static int stream(ePager_t *pager, uint64_t *sum)
+{
+  for(uint64_t page = 0; page < ePagerPages(pager); ++page) {
+    eMemPtr_t p;
+    if(ePagerAcquire(pager, page, &p))
+      return -1;
+    uint32_t *w = p.host;
+    for(unsigned i = 0; i < PAGE / sizeof(uint32_t); ++i)
+      *sum += w[i]++;
+    ePagerRelease(pager, page, 1);
+  }
+  return 0;
+}
+
+static int randomAccess(ePager_t *pager)
+{
+  srand(7);
+  for(unsigned i = 0; i < 1000; ++i) {
+    uint64_t page = rand() % ePagerPages(pager);
+    unsigned word = rand() % (PAGE / sizeof(uint32_t));
+    eMemPtr_t p;
+    if(ePagerAcquire(pager, page, &p))
+      return -1;
+    uint32_t expect = (uint32_t)(page * (PAGE / sizeof(uint32_t)) + word) + 1;
+    if(((uint32_t*)p.host)[word] != expect) {
+      printf("page %llu word %u: %u != %u\n", (unsigned long long)page, word,
+             ((uint32_t*)p.host)[word], expect);
+      return -1;
+    }
+    ePagerRelease(pager, page, 0);
+  }
+  return 0;
+}
+
+static int failWriteback;
+
+static int fetchWords(void *ctx, uint64_t page, uint64_t offset, void *dst, uint32_t size)
+{
+  (void)page;
+  memcpy(dst, (char*)ctx + offset, size);
+  return 0;
+}
+
+static int writebackWords(void *ctx, uint64_t page, uint64_t offset, const void *src, uint32_t size)
+{
+  (void)page;
+  if(failWriteback)
+    return -1;
+  memcpy((char*)ctx + offset, src, size);
+  return 0;
+}
+
+// a dirty page whose writeback fails stays cached, nothing gets fetched over it
+static int checkWritebackFailure(void)
+{
+  static uint32_t words[2 * 64 / sizeof(uint32_t)];
+  ePagerSource_t src = { .fetch = fetchWords, .writeback = writebackWords, .ctx = words };
+  ePager_t *pager = ePagerCreate(&src, sizeof(words), 64, 1, 0, &ePagerLru);
+  eMemPtr_t p;
+  if(!pager || ePagerAcquire(pager, 0, &p))
+    return -1;
+  ((uint32_t*)p.host)[0] = 42;
+  ePagerRelease(pager, 0, 1);
+
+  failWriteback = 1;
+  int ret = !ePagerAcquire(pager, 1, &p);
+  failWriteback = 0;
+  if(!ret && !ePagerAcquire(pager, 0, &p)) {
+    ret = ((uint32_t*)p.host)[0] != 42;
+    ePagerRelease(pager, 0, 0);
+  }
+  ePagerDestroy(pager);
+  if(ret || words[0] != 42) {
+    printf("dirty page lost on a failed writeback\n");
+    return -1;
+  }
+  return 0;
+}
+
+int main(void)
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  if(checkWritebackFailure())
+    return 1;
+
+  if(!(data = malloc(DATASET)))
+    return 1;
+  uint64_t expect = 0, sum = 0;
+  for(uint32_t i = 0; i < DATASET / sizeof(uint32_t); ++i)
+    expect += data[i] = i;
+
+  ePagerSource_t src = ePagerSourceMem(data);
+  ePager_t *pager = ePagerCreate(&src, DATASET, PAGE, SLOTS, 4, &ePagerLru);
+  if(!pager)
+    return 1;
+
+  if(MEASURE( "stream 40 MB through 4 MB of eMem", stream(pager, &sum) ) || sum != expect) {
+    printf("stream mismatch\n");
+    return 1;
+  }
+  if(MEASURE( "random access", randomAccess(pager) ))
+    return 1;
+
+  ePagerStats_t stats;
+  ePagerGetStats(pager, &stats);
+  printf("hits %llu, misses %llu, prefetched %llu, evictions %llu, writebacks %llu\n",
+         (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+         (unsigned long long)stats.prefetched, (unsigned long long)stats.evictions,
+         (unsigned long long)stats.writebacks);
+  ePagerDestroy(pager);
+
+  // every increment made it back to the dataset
+  for(uint32_t i = 0; i < DATASET / sizeof(uint32_t); ++i)
+    if(data[i] != i + 1) {
+      printf("writeback missing at word %u\n", i);
+      return 1;
+    }
+  free(data);
+  return 0;
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "ehal-pmr.hpp"
+
+int main()
+{
+  extern eConfig_t ecfg;
+  if(!ecfg.lemem->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  {
+    std::pmr::vector<uint32_t> v(ehal::eMemResource());
+    for(uint32_t i = 0; i < 10000; ++i)
+      v.push_back(i);
+    if(!ehal::inEMem(v.data())
+       || ehal::toHost<uint32_t>(ehal::toEpi(v.data())) != v.data()
+       || ehal::toHost<uint32_t>(ehal::toEpi(&v[9999]))[0] != 9999) {
+      printf("pmr vector not in eMem\n");
+      return 1;
+    }
+  }
+
+  {
+    ehal::EMemMonotonic arena(0x1000);
+    std::pmr::vector<std::pmr::string> names(&arena);
+    for(int i = 0; i < 100; ++i)
+      names.emplace_back("a string too long for the small string buffer");
+    if(!ehal::inEMem(names.data()) || !ehal::inEMem(names[99].data())) {
+      printf("monotonic arena not in eMem\n");
+      return 1;
+    }
+  }
+
+  eMemStats_t stats;
+  eMemStats(&stats);
+  printf("pmr done, %llu allocs / %llu frees\n",
+         (unsigned long long)stats.allocs, (unsigned long long)stats.frees);
+  return 0;
+}
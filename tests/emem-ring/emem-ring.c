@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include "ehal.h"
+
+#define ITEMS       (1u << 20)
+#define BATCH       16
+#define PRODUCERS   4
+
+#define MEASURE( str, X ) \
+({ \
+  struct timeval tbgn, tend; \
+  gettimeofday(&tbgn, NULL); \
+  int ret = X; \
+  gettimeofday(&tend, NULL); \
+  printf("%s: measured: %ld μs\n", \
+         str, \
+         ((tend.tv_sec * 1000000 + tend.tv_usec) \
+         - (tbgn.tv_sec * 1000000 + tbgn.tv_usec))); \
+  ret; \
+})
+
+extern eConfig_t ecfg;
+
+typedef struct {
+  uint32_t seq;
+  uint32_t producer;
+} item_t;
+
+static void* spscProducer(void *arg)
+{
+  eRingPort_t port = eRingProducer((eRing_t*)arg);
+  for(uint32_t seq = 0; seq < ITEMS; ) {
+    uint32_t n = eRingReserve(&port, BATCH);
+    if(!n)
+      sched_yield();
+    for(uint32_t i = 0; i < n; ++i)
+      ((item_t*)eRingAt(&port, i))->seq = seq + i;
+    eRingCommit(&port, n);
+    seq += n;
+  }
+  return NULL;
+}
+
+static int spsc(eRing_t *ring)
+{
+  pthread_t thread;
+  if(pthread_create(&thread, NULL, spscProducer, ring))
+    return -1;
+
+  int ret = 0;
+  eRingPort_t port = eRingConsumer(ring);
+  for(uint32_t seq = 0; seq < ITEMS; ) {
+    uint32_t n = eRingPeek(&port, BATCH);
+    if(!n)
+      sched_yield();
+    for(uint32_t i = 0; i < n; ++i)
+      ret |= ((item_t*)eRingAt(&port, i))->seq != seq + i;
+    eRingRelease(&port, n);
+    seq += n;
+  }
+  pthread_join(thread, NULL);
+  if(ret)
+    printf("SPSC sequence broken\n");
+  return ret;
+}
+
+static eRing_t *mpscRing;
+
+static void* mpscProducer(void *arg)
+{
+  uint32_t producer = (uint32_t)(uintptr_t)arg, idx;
+  for(uint32_t seq = 0; seq < ITEMS / PRODUCERS; seq += BATCH) {
+    while(!eRingClaim(mpscRing, BATCH, &idx))
+      sched_yield();
+    for(uint32_t i = 0; i < BATCH; ++i)
+      *(item_t*)eRingSlot(mpscRing, idx + i) = (item_t){ seq + i, producer };
+    eRingPublish(mpscRing, idx, BATCH);
+  }
+  return NULL;
+}
+
+static int mpsc(void)
+{
+  pthread_t thread[PRODUCERS];
+  for(uintptr_t p = 0; p < PRODUCERS; ++p)
+    if(pthread_create(&thread[p], NULL, mpscProducer, (void*)p))
+      return -1;
+
+  int ret = 0;
+  uint32_t next[PRODUCERS] = { 0 };
+  eRingPort_t port = eRingConsumer(mpscRing);
+  for(uint32_t cnt = 0; cnt < ITEMS; ) {
+    uint32_t n = eRingPeek(&port, BATCH);
+    if(!n)
+      sched_yield();
+    for(uint32_t i = 0; i < n; ++i) {
+      item_t *item = eRingAt(&port, i);
+      ret |= item->producer >= PRODUCERS || item->seq != next[item->producer]++;
+    }
+    eRingRelease(&port, n);
+    cnt += n;
+  }
+  for(unsigned p = 0; p < PRODUCERS; ++p)
+    pthread_join(thread[p], NULL);
+  if(ret)
+    printf("MPSC per producer order broken\n");
+  return ret;
+}
+
+// ring in the SRAM of eCore (0,0), as fed by the host
+static int sram(void)
+{
+  eCoreMemMap_t *eCore = &ecfg.chip[0].eCoreRoot[0][0];
+  eRing_t *ring = eRingInit((void*)eCore->bank[3], 64, sizeof(item_t), 0);
+  if(!ring || eRingBytes(64, sizeof(item_t)) > sizeof(eCore->bank[3]))
+    return -1;
+
+  eRingPort_t prod = eRingProducer(ring), cons = eRingConsumer(ring);
+  item_t item;
+  for(uint32_t i = 0; i < 64; ++i)
+    if(!eRingPush(&prod, &(item_t){ i, 0 }))
+      return -1;
+  if(eRingPush(&prod, &item))
+    return -1;                          // full
+  for(uint32_t i = 0; i < 64; ++i)
+    if(!eRingPop(&cons, &item) || item.seq != i)
+      return -1;
+  return eRingPop(&cons, &item) || !eRingValid(ring) ? -1 : 0;
+}
+
+int main(void)
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+
+  if(eMemRingCreate(3, sizeof(item_t), 0) || eMemRingCreate(4, 0, 0))
+    return 1;
+
+  eRing_t *ring = eMemRingCreate(256, sizeof(item_t), 0);
+  mpscRing = eMemRingCreate(256, sizeof(item_t), ERING_MPSC);
+  if(!ring || !mpscRing
+     || eMemRegion()->epi_base > (char*)ring
+     || (uintptr_t)&ring->tail - (uintptr_t)&ring->head < ERING_LINE)
+    return 1;
+
+  if(MEASURE( "SPSC 1M items", spsc(ring) )
+     || MEASURE( "MPSC 1M items", mpsc() )
+     || sram()) {
+    printf("ring test failed\n");
+    return 1;
+  }
+
+  eMemRingDestroy(ring);
+  eMemRingDestroy(mpscRing);
+  printf("rings ok\n");
+  return 0;
+}
@@ -9,6 +9,9 @@
 #include "memmap-epiphany-system.h"
 #include "memmap-epiphany-cores.h"
 #include "loader/ehal-srec-loader.h"
+#include "ehal-copy.h"
+#include "ehal-fence.h"
+#include "ehal-shadow.h"
 
 #define MEASURE( str, X ) \
 ({ \
@@ -39,33 +42,37 @@
 // Resume a core after halt
 void e_resume(eCoreMemMap_t* eCore)
 {
-  eCore->regs.debug.command = 0;
+  eStoreOrdered(&eCore->regs.debug.reg, 0);
 }
 
 void e_halt(eCoreMemMap_t* eCore)
 {
-  eCore->regs.debug.command = 1;
+  eStoreOrdered(&eCore->regs.debug.reg, 1);
 }
 
 int ee_soft_reset_dma(eCoreMemMap_t* eCore)
 {
+  eRegWrite_t buf[32];
+  eRegBatch_t batch = EREG_BATCH_INIT( buf );
+
   /* pause DMA */
-  eCore->regs.config.reg |= 0x01000000; // undocumented! (changes reserved)
+  eRegBatchUpdate(&batch, &eCore->regs.config.reg, 0x01000000, 0x01000000); // undocumented! (changes reserved)
 
   unsigned i, dmac = sizeof(eCore->regs.dma)/sizeof(eCore->regs.dma[0]);
   for(i=0; i<dmac; ++i) {
-    eCore->regs.dma[i].config.dmaen = 0; // pause DMA
-    eCore->regs.dma[i].config.reg = 0;
-    eCore->regs.dma[i].stride = 0;
-    eCore->regs.dma[i].count.reg = 0;
-    eCore->regs.dma[i].srcaddr = 0;
-    eCore->regs.dma[i].dstaddr = 0;
-    eCore->regs.dma[i].status.reg = 0;
-    eCore->regs.dma[i].config.dmaen = 1; // unpause DMA
+    eRegBatchSetField(&batch, eCore->regs.dma[i].config, dmaen, 0); // pause DMA
+    eRegBatchStore(&batch, &eCore->regs.dma[i].config.reg, 0);
+    eRegBatchStore(&batch, &eCore->regs.dma[i].stride, 0);
+    eRegBatchStore(&batch, &eCore->regs.dma[i].count.reg, 0);
+    eRegBatchStore(&batch, &eCore->regs.dma[i].srcaddr, 0);
+    eRegBatchStore(&batch, &eCore->regs.dma[i].dstaddr, 0);
+    eRegBatchStore(&batch, &eCore->regs.dma[i].status.reg, 0);
+    eRegBatchSetField(&batch, eCore->regs.dma[i].config, dmaen, 1); // unpause DMA
   }
 
   /* unpause DMA */
-  eCore->regs.config.reg &= ~0x01000000; // undocumented!
+  eRegBatchUpdate(&batch, &eCore->regs.config.reg, 0x01000000, 0); // undocumented!
+  eRegBatchFlush(&batch);
 
   unsigned c = 2000;
   unsigned dmamask = (0x1 << dmac) - 1;
@@ -88,30 +95,34 @@ int ee_soft_reset_dma(eCoreMemMap_t* eCore)
 
 int ee_reset_regs(eCoreMemMap_t* eCore, int reset_dma)
 {
-  memset((void*)eCore->regs.r, 0, sizeof(eCore->regs.r));
+  eFill(eCore->regs.r, 0, sizeof(eCore->regs.r));
 
   if(reset_dma != -1
      && !ee_soft_reset_dma(eCore))
     return -1;
 
+  eRegWrite_t buf[32];
+  eRegBatch_t batch = EREG_BATCH_INIT( buf );
+
   /* Enable clock gating */
-  eCore->regs.config.lpmode = 1;
-  eCore->regs.fstatus = 0;
-  eCore->regs.pc = 0;
-  eCore->regs.lc = 0;
-  eCore->regs.ls = 0;
-  eCore->regs.le = 0;
-  eCore->regs.iret = 0;
+  eRegBatchSetField(&batch, eCore->regs.config, lpmode, 1);
+  eRegBatchStore(&batch, &eCore->regs.fstatus, 0);
+  eRegBatchStore(&batch, &eCore->regs.pc, 0);
+  eRegBatchStore(&batch, &eCore->regs.lc, 0);
+  eRegBatchStore(&batch, &eCore->regs.ls, 0);
+  eRegBatchStore(&batch, &eCore->regs.le, 0);
+  eRegBatchStore(&batch, &eCore->regs.iret, 0);
   /* Mask all but SYNC irq */
-  eCore->regs.imask = ~1;
-  eCore->regs.ilatcl = ~0;
+  eRegBatchStore(&batch, &eCore->regs.imask, ~1);
+  eRegBatchStore(&batch, &eCore->regs.ilatcl, ~0);
   unsigned i;
   for(i=0; i<sizeof(eCore->regs.ctimer)/sizeof(eCore->regs.ctimer[0]); ++i)
-    eCore->regs.ctimer[i] = 0;
-  eCore->regs.memstatus.reg = 0;
-  eCore->regs.memprotect.reg = 0;
+    eRegBatchStore(&batch, &eCore->regs.ctimer[i], 0);
+  eRegBatchStore(&batch, &eCore->regs.memstatus.reg, 0);
+  eRegBatchStore(&batch, &eCore->regs.memprotect.reg, 0);
   /* Enable clock gating */
-  eCore->regs.meshconfig.lpmode = 1;
+  eRegBatchSetField(&batch, eCore->regs.meshconfig, lpmode, 1);
+  eRegBatchFlush(&batch);
 
   return 0;
 }
@@ -170,18 +181,21 @@ int ee_soft_reset_core(eCoreMemMap_t* eCore)
     if (eCore->regs.dma[i].status.dmastate & 7)
       eCorePrintf(0, eCore, "%s(): DMA%d NOT IDLE\n", __func__, i);
 
+  /* Registers as left by the previous program */
+  eRegForgetCore(eCore);
+
   /* Abort DMA transfers */
   if (ee_soft_reset_dma(eCore))
     return -1;
 
   /* Disable timers */
-  eCore->regs.config.reg = 0;
+  eRegStore(&eCore->regs.config.reg, 0);
   eCore->regs.ilatcl = ~0;
-  eCore->regs.imask = 0;
+  eRegStore(&eCore->regs.imask, 0);
   eCore->regs.iret = 0x2c; /* clear_ipend */
   eCore->regs.pc = 0x2c; /* clear_ipend */
 
-  memcpy((void*)eCore->bank, soft_reset_payload, sizeof(soft_reset_payload));
+  eCopy(eCore->bank, soft_reset_payload, sizeof(soft_reset_payload));
 
   /* Set active bit */
   eCore->regs.fstatus = 1;
@@ -212,16 +226,15 @@ int ee_soft_reset_core(eCoreMemMap_t* eCore)
 // only use the commands that should be issued from the esys!!!
 void reset()
 {
-  ((eSysRegs*)0x808f0000)->esysreset = 0x0;
-  __asm__ volatile("" ::: "memory");
+  eStoreOrdered(&((eSysRegs*)0x808f0000)->esysreset, 0x0);
+  eFenceComplete();
   usleep(200000);
 
 	// Perform post-reset, platform specific operations
 //	if (e_platform.chip[0].type == E_E16G301) // TODO: assume one chip
 //	if ((e_platform.type == E_ZEDBOARD1601) || (e_platform.type == E_PARALLELLA1601))
   __typeof__(&((eSysRegs*)0x808f0000)->esysconfig.reg) esysconfig = &((eSysRegs*)0x808f0000)->esysconfig.reg;
-  *esysconfig = 0x50000000;
-  __asm__ volatile("" ::: "memory");
+  eStoreOrdered(esysconfig, 0x50000000);
 
 // The register must be written, there shall be NO read beforehand. Otherwise stall!
 //                      E16G301               E64G301
@@ -231,16 +244,15 @@ void reset()
 //  assert(elinkmodecfg == (volatile uint32_t*)0x88bf0300);
 
   //      LCLK Transmit Frequency control: Divide cclk by 0->2, 1->4, 2->8
-  *elinkmodecfgEast = 1;
-  __asm__ volatile("" ::: "memory");
-  *esysconfig = 0x0;
+  eStoreOrdered(elinkmodecfgEast, 1);
+  eStoreOrdered(esysconfig, 0x0);
 
 
 /*
   // put individual cores into reset
   eCoreMemMap_t* eCoreBgn = &eCoresGMemBaseVA[32][8];
   eCoreBgn->regs.corereset.reset = 1;
-  __asm__ volatile("" ::: "memory");
+  eFenceStore();
   eCoreBgn->regs.corereset.reset = 0;
 */
 }
@@ -297,7 +309,7 @@ int main(int argc, char* argv[])
   char* srecend = (char*)srecbgn + strlen(srecbgn);
   printf("%s\n", srecbgn);
 
-  memset( (char*)eCoreBgn->sram, 0, 0x8000 );
+  eFill(eCoreBgn->sram, 0, sizeof(eCoreBgn->sram));
   int ret = MEASURE("parse_srec", parse_srec(srecbgn, srecend,
                                   eCoreBgn, eCoreBgn));
   printf("%d\n", ret);
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// SPDX-FileCopyrightText:  2022 Patrick Siegl <code@siegl.it>
+
+#include <stdio.h>
+#include <string.h>
+#include "ehal.h"
+#include "ehal-banks.h"
+#include "loader/ehal-srec-loader.h"
+
+#define CODE_SIZE   0x2100              // spills into bank 1
+#define TABLE       0x7000
+
+extern eConfig_t ecfg;
+
+static void srecRecord(FILE *f, uint32_t addr, const uint8_t *data, unsigned len)
+{
+  unsigned char sum = len + 5;
+  fprintf(f, "S3%02X%08X", len + 5, addr);
+  sum += (addr >> 24) + (addr >> 16) + (addr >> 8) + addr;
+  for(unsigned i = 0; i < len; ++i) {
+    fprintf(f, "%02X", data[i]);
+    sum += data[i];
+  }
+  fprintf(f, "%02X\n", (unsigned char)~sum);
+}
+
+static int checkExtent(const char *dir)
+{
+  char fname[512];
+  snprintf(fname, sizeof(fname), "%s/sram-banks.srec", dir);
+  FILE *f = fopen(fname, "w");
+  if(!f)
+    return -1;
+  uint8_t data[32];
+  memset(data, 0xA5, sizeof(data));
+  fprintf(f, "S00600004844521B\n");
+  for(uint32_t addr = 0; addr < CODE_SIZE; addr += sizeof(data))
+    srecRecord(f, addr, data, sizeof(data));
+  fprintf(f, "S70500000000FA\n");
+  fclose(f);
+
+  uint32_t bgn, end;
+  if(extent_srec(fname, &bgn, &end) || bgn != 0 || end != CODE_SIZE) {
+    printf("extent_srec failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+// both sides of a reservation in the middle of a bank stay usable
+static int checkSplit(void)
+{
+  eBankPlan_t plan;
+  eBankPlanInit(&plan);
+  if(eBankPlanReserve(&plan, TABLE, 0x10, EBANK_LDST, 0)
+     || eBankPlanReserve(&plan, 0x6000, 0x900, EBANK_LDST, 0))
+    return -1;
+  // solely fits behind the table
+  eBankBuf_t tail = { .name = "tail", .size = 0x7e0, .access = EBANK_LDST, .bank = 3 };
+  if(eBankPlace(&plan, &tail, 1) < 0 || tail.offset != TABLE + 0x10) {
+    printf("free window behind a reservation lost\n");
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if(!eMemRegion()->space) {
+    printf("EPIPHANY not bootstrapped\n");
+    return 1;
+  }
+  if(checkExtent(argc > 1 ? argv[1] : ".") || checkSplit())
+    return 1;
+
+  eBankPlan_t plan;
+  eBankPlanInit(&plan);
+  if(eBankPlanReserve(&plan, 0, CODE_SIZE, EBANK_FETCH, 100)
+     || eBankPlanReserve(&plan, 0x7800, 0x800, EBANK_LDST, 50)  // stack
+     || eBankPlanReserve(&plan, TABLE, 0x10, EBANK_LDST, 0)
+     || !eBankPlanReserve(&plan, 0x7ff0, 0x20, EBANK_LDST, 0))
+    return 1;
+
+  eBankBuf_t bufs[] = {
+    { .name = "in0",    .size = 0x1000, .align = 64, .access = EBANK_DMA | EBANK_LDST, .weight = 10, .bank = -1 },
+    { .name = "in1",    .size = 0x1000, .align = 64, .access = EBANK_DMA | EBANK_LDST, .weight = 10, .bank = -1 },
+    { .name = "coeffs", .size = 0x0800, .align = 8,  .access = EBANK_LDST,             .weight = 5,  .bank = -1 },
+    { .name = "result", .size = 0x0400, .align = 64, .access = EBANK_MESH,             .weight = 2,  .bank = -1 },
+    { .name = "log",    .size = 0x0200, .align = 0,  .access = EBANK_LDST,             .weight = 0,  .bank = -1 },
+  };
+  unsigned n = sizeof(bufs) / sizeof(bufs[0]);
+  int conflicts = eBankPlace(&plan, bufs, n);
+  eBankPlanPrint(stdout, &plan, bufs, n);
+  eBankPlanHeader(stdout, "SRAM_", bufs, n);
+  if(conflicts < 0)
+    return 1;
+
+  for(unsigned i = 0; i < n; ++i) {
+    uint32_t bgn = bufs[i].offset, end = bgn + bufs[i].size;
+    if(end > 0x7800 || bgn < CODE_SIZE || (bgn < TABLE + 0x10 && TABLE < end)
+       || (bufs[i].align && bgn & (bufs[i].align - 1))) {
+      printf("%s misplaced at 0x%x\n", bufs[i].name, bgn);
+      return 1;
+    }
+    for(unsigned j = 0; j < i; ++j)
+      if(bgn < bufs[j].offset + bufs[j].size && bufs[j].offset < end) {
+        printf("%s overlaps %s\n", bufs[i].name, bufs[j].name);
+        return 1;
+      }
+    // the hot DMA buffers stay out of the code bank
+    if(bufs[i].access & EBANK_DMA && bgn / EBANK_SIZE <= CODE_SIZE / EBANK_SIZE) {
+      printf("%s shares the bank of the code\n", bufs[i].name);
+      return 1;
+    }
+  }
+
+  // too large for what is left
+  eBankBuf_t huge = { .name = "huge", .size = 0x4000, .bank = -1 };
+  if(eBankPlace(&plan, &huge, 1) >= 0)
+    return 1;
+
+  eCoreMemMap_t* eCoreBgn = &ecfg.chip[0].eCoreRoot[0][0];
+  eCoreMemMap_t* eCoreEnd = &ecfg.chip[0].eCoreRoot[ecfg.chip[0].xyDim-1][ecfg.chip[0].xyDim-1];
+  if(eBankPlanApply(bufs, n, TABLE, eCoreBgn, eCoreEnd))
+    return 1;
+  for(eCoreMemMap_t *c = eCoreBgn; c <= eCoreEnd; c += ECORES_MAX_DIM + 1)
+    for(unsigned i = 0; i < n; ++i)
+      if(((volatile uint32_t*)(c->sram + TABLE))[i] != bufs[i].offset) {
+        printf("offset table mismatch\n");
+        return 1;
+      }
+
+  printf("SRAM bank plan ok, %d contended banks\n", conflicts);
+  return 0;
+}